@@ -6,10 +6,21 @@
  * ----------------------------------------------------------------------------
  */
 
-//var gateway = `ws://${window.location.hostname}/ws`;
-var gateway = `ws://10.101.29.204/ws`;
+// The binary endpoint is /ws/bin, the JSON one /ws (kept for older UIs)
+//var gateway = `ws://${window.location.hostname}/ws/bin`;
+var gateway = `ws://10.101.29.204/ws/bin`;
 var websocket;
 
+// Must match WS_PROTO_VERSION / WS_FRAME_STATE in src/ws_proto.h
+const WS_PROTO_VERSION = 2;
+const WS_FRAME_STATE   = 0x01;
+const WS_FRAME_CAPTURE = 0x02;
+const WS_FRAME_SCAN    = 0x03;
+const WS_FLAG_RF       = 0x01;
+const WS_FLAG_SWR_TRIP = 0x02;
+const WS_FLAG_SCAN     = 0x04;
+const WS_FLAG_RELAY_FAULT = 0x08;
+
 // ----------------------------------------------------------------------------
 // Initialization
 // ----------------------------------------------------------------------------
@@ -19,6 +30,8 @@ window.addEventListener('load', onLoad);
 function onLoad(event) {
     initWebSocket();
     initButton();
+    initHealth();
+    initTrend();
     //initVU();
 }
 
@@ -29,6 +42,7 @@ function onLoad(event) {
 function initWebSocket() {
     console.log('Trying to open a WebSocket connection...');
     websocket = new WebSocket(gateway);
+    websocket.binaryType = 'arraybuffer';
     websocket.onopen    = onOpen;
     websocket.onclose   = onClose;
     websocket.onmessage = onMessage;
@@ -43,9 +57,56 @@ function onClose(event) {
     setTimeout(initWebSocket, 2000);
 }
 
+function decodeStateFrame(buffer) {
+    let view = new DataView(buffer);
+    if (view.byteLength < 16) return null;
+    if (view.getUint8(0) != WS_PROTO_VERSION || view.getUint8(1) != WS_FRAME_STATE) return null;
+    return {
+        status:    view.getUint8(2) ? 'on' : 'off',
+        dir:       view.getUint8(3),
+        wanted:    view.getUint8(4),
+        rf:        (view.getUint8(5) & WS_FLAG_RF) != 0,
+        trip:      (view.getUint8(5) & WS_FLAG_SWR_TRIP) != 0,
+        scan:      (view.getUint8(5) & WS_FLAG_SCAN) != 0,
+        fault:     (view.getUint8(5) & WS_FLAG_RELAY_FAULT) != 0,
+        swr:       view.getUint16(6, true) / 256,
+        seq:       view.getUint32(8, true),
+        timestamp: view.getUint32(12, true)
+    };
+}
+
 function onMessage(event) {
-    let data = JSON.parse(event.data);
-    document.getElementById('led').className = data.stat;
+    if (event.data instanceof ArrayBuffer && new DataView(event.data).getUint8(1) == WS_FRAME_CAPTURE) {
+        drawCapture(decodeCapture(event.data));
+        return;
+    }
+    if (event.data instanceof ArrayBuffer && new DataView(event.data).getUint8(1) == WS_FRAME_SCAN) {
+        showScan(decodeScan(event.data));
+        return;
+    }
+    let data = (event.data instanceof ArrayBuffer) ? decodeStateFrame(event.data) : JSON.parse(event.data);
+    if (!data) return;
+    if (data.ack !== undefined) {
+        if (!data.ok) console.log(`Command '${data.ack}' rejected`);
+        return;
+    }
+    if (data.capture) {
+        fetchCapture(data.capture);
+        return;
+    }
+    if (typeof data.scan == 'object') {
+        showScan(data.scan);
+        return;
+    }
+    document.getElementById('scan').className = data.scan ? 'on' : 'off';
+    document.getElementById('led').className = data.status;
+    trendDir = data.dir;
+    if (data.swr !== undefined) {
+        document.getElementById('swr').textContent = data.swr ? `SWR ${data.swr.toFixed(2)}` : 'No RF';
+    }
+    document.getElementById('led_trip').className = data.trip ? 'on' : 'off';
+    document.getElementById('led_fault').className = data.fault ? 'on' : 'off';
+    document.getElementById('clear').disabled = !(data.trip || data.fault) || data.rf;
 
     //let index = 4;
     //document.getElementById('led_dir_'+index).className = "on";
@@ -58,6 +119,194 @@ function onMessage(event) {
     }
 }
 
+// ----------------------------------------------------------------------------
+// I2C bus health, summed over all expanders from /metrics
+// ----------------------------------------------------------------------------
+
+var metricsUrl = gateway.replace(/^ws/, 'http').replace(/\/ws\/bin$/, '/metrics');
+
+function initHealth() {
+    updateHealth();
+    setInterval(updateHealth, 5000);
+}
+
+function updateHealth() {
+    fetch(metricsUrl)
+        .then(response => response.text())
+        .then(text => {
+            let sum = {};
+            for (let line of text.split('\n')) {
+                let m = line.match(/^(\w+)\{[^}]*\} (\d+)$/);
+                if (m) sum[m[1]] = (sum[m[1]] || 0) + parseInt(m[2], 10);
+            }
+            document.getElementById('i2c').textContent =
+                `I2C errors ${sum.i2c_errors_total || 0}, retries ${sum.i2c_retries_total || 0}, ` +
+                `recoveries ${sum.i2c_recoveries_total || 0}`;
+        })
+        .catch(() => {});
+}
+
+// ----------------------------------------------------------------------------
+// SWR trend of the active direction over the last 10 minutes, from /history
+// ----------------------------------------------------------------------------
+
+var historyUrl = gateway.replace(/^ws/, 'http').replace(/\/ws\/bin$/, '/history');
+var trendDir = 0;
+
+function initTrend() {
+    updateTrend();
+    setInterval(updateTrend, 10000);
+}
+
+// binary export: 4-byte header, then 16-byte records (see src/swr_history.h)
+function decodeHistory(buffer) {
+    let view = new DataView(buffer);
+    let records = [];
+    if (view.byteLength < 4 || view.getUint8(0) != 0x48 || view.getUint8(1) != 1) return records;
+    let size = view.getUint8(3);
+    for (let off = 4; off + size <= view.byteLength; off += size) {
+        records.push({
+            t:      view.getUint32(off, true),
+            fwdMw:  view.getUint32(off + 4, true),
+            swrMin: view.getUint16(off + 8, true) / 256,
+            swrAvg: view.getUint16(off + 10, true) / 256,
+            swrMax: view.getUint16(off + 12, true) / 256,
+            dir:    view.getUint8(off + 14),
+            rfPct:  view.getUint8(off + 15)
+        });
+    }
+    return records;
+}
+
+function updateTrend() {
+    if (!trendDir) return;
+    fetch(`${historyUrl}?tier=1s&last=600000&dir=${trendDir}`)
+        .then(response => response.arrayBuffer())
+        .then(buffer => drawTrend(decodeHistory(buffer)))
+        .catch(() => {});
+}
+
+function drawTrend(records) {
+    let canvas = document.getElementById('trend');
+    let ctx = canvas.getContext('2d');
+    ctx.clearRect(0, 0, canvas.width, canvas.height);
+    if (!records.length) return;
+
+    // SWR 1..3 over the height, time over the width
+    let t0 = records[0].t, span = Math.max(records[records.length - 1].t - t0, 1);
+    let x = r => (r.t - t0) / span * canvas.width;
+    let y = swr => canvas.height - Math.min(Math.max(swr - 1, 0) / 2, 1) * canvas.height;
+
+    ctx.fillStyle = 'rgba(255, 0, 0, 0.3)';
+    for (let r of records) {
+        if (r.rfPct) ctx.fillRect(x(r), y(r.swrMax), 1, y(r.swrMin) - y(r.swrMax) + 1);
+    }
+    ctx.strokeStyle = 'red';
+    ctx.beginPath();
+    for (let r of records) {
+        if (r.rfPct) ctx.lineTo(x(r), y(r.swrAvg));
+        else ctx.moveTo(x(r), canvas.height);
+    }
+    ctx.stroke();
+}
+
+// ----------------------------------------------------------------------------
+// Transient captures, pushed on /ws/bin or fetched from /capture
+// ----------------------------------------------------------------------------
+
+var captureUrl = gateway.replace(/^ws/, 'http').replace(/\/ws\/bin$/, '/capture');
+
+function decodeCapture(buffer) {
+    let view = new DataView(buffer);
+    if (view.byteLength < 24 || view.getUint8(0) != WS_PROTO_VERSION || view.getUint8(1) != WS_FRAME_CAPTURE) return null;
+    let capture = {
+        dir:        view.getUint8(2),
+        channels:   view.getUint8(5),
+        id:         view.getUint32(8, true),
+        timestamp:  view.getUint32(12, true),
+        pre:        view.getUint16(16, true),
+        post:       view.getUint16(18, true),
+        sampleRate: view.getUint32(20, true),
+        fwd: [],
+        ref: []
+    };
+    let off = 24;
+    for (let i = 0; i < capture.pre + capture.post && off + capture.channels * 2 <= view.byteLength; i++) {
+        capture.fwd.push(view.getUint16(off, true));
+        capture.ref.push(view.getUint16(off + 2, true));
+        off += capture.channels * 2;
+    }
+    return capture;
+}
+
+function fetchCapture(id) {
+    fetch(`${captureUrl}?id=${id}`)
+        .then(response => response.arrayBuffer())
+        .then(buffer => drawCapture(decodeCapture(buffer)))
+        .catch(() => {});
+}
+
+function drawCapture(capture) {
+    if (!capture) return;
+    let canvas = document.getElementById('capture');
+    let ctx = canvas.getContext('2d');
+    ctx.clearRect(0, 0, canvas.width, canvas.height);
+
+    let n = capture.fwd.length;
+    let x = i => i / Math.max(n - 1, 1) * canvas.width;
+    let y = v => canvas.height - v / 4095 * canvas.height;
+    let trace = (samples, color) => {
+        ctx.strokeStyle = color;
+        ctx.beginPath();
+        samples.forEach((v, i) => ctx.lineTo(x(i), y(v)));
+        ctx.stroke();
+    };
+    trace(capture.fwd, 'green');
+    trace(capture.ref, 'red');
+
+    // trigger point
+    ctx.strokeStyle = 'gray';
+    ctx.beginPath();
+    ctx.moveTo(x(capture.pre), 0);
+    ctx.lineTo(x(capture.pre), canvas.height);
+    ctx.stroke();
+
+    document.getElementById('capture_info').textContent =
+        `Capture #${capture.id}, direction ${capture.dir}, ${(n / capture.sampleRate * 1000).toFixed(0)} ms`;
+}
+
+// ----------------------------------------------------------------------------
+// Antenna scan results, best SWR first
+// ----------------------------------------------------------------------------
+
+const SCAN_STATUS = ['done', 'stopped by the rotary switch', 'stopped by RF', 'stopped', 'relay did not switch'];
+
+function decodeScan(buffer) {
+    let view = new DataView(buffer);
+    if (view.byteLength < 8 || view.getUint8(0) != WS_PROTO_VERSION) return null;
+    let scan = { status: view.getUint8(2), ms: view.getUint32(4, true), ranked: [] };
+    for (let i = 0, off = 8; i < view.getUint8(3) && off + 8 <= view.byteLength; i++, off += 8) {
+        scan.ranked.push({
+            dir: view.getUint8(off),
+            n:   view.getUint8(off + 1),
+            swr: view.getUint16(off + 2, true) / 256,
+            min: view.getUint16(off + 4, true) / 256,
+            max: view.getUint16(off + 6, true) / 256
+        });
+    }
+    return scan;
+}
+
+function showScan(scan) {
+    if (!scan) return;
+    let rows = scan.ranked.map(e => e.n
+        ? `<tr><td>${e.dir}</td><td>${e.swr.toFixed(2)}</td><td>${e.min.toFixed(2)} - ${e.max.toFixed(2)}</td></tr>`
+        : `<tr><td>${e.dir}</td><td>-</td><td>no signal</td></tr>`);
+    document.getElementById('scan_table').innerHTML =
+        `<caption>Scan ${SCAN_STATUS[scan.status] || scan.status}, ${scan.ms} ms</caption>` +
+        '<tr><th>dir</th><th>SWR</th><th>range</th></tr>' + rows.join('');
+}
+
 // ----------------------------------------------------------------------------
 // Button handling
 // ----------------------------------------------------------------------------
@@ -0,0 +1,65 @@
+#include "adc_pipeline.h"
+
+void AdcPipeline::begin(uint16_t decimation) {
+    decim = decimation ? decimation : 1;
+    resetWindow();
+}
+
+void AdcPipeline::resetWindow() {
+    for (uint8_t c = 0; c < ADC_CHANNELS; c++) {
+        winSum[c] = 0;
+        winMin[c] = 0xffff;
+        winMax[c] = 0;
+    }
+    winCount = 0;
+}
+
+bool AdcPipeline::push(const AdcSample &v, uint32_t nowMs) {
+    uint32_t h = ringHead.load(std::memory_order_relaxed);
+    ring[h & (ADC_RING_LEN - 1)] = v;
+    ringHead.store(h + 1, std::memory_order_release);
+
+    for (uint8_t c = 0; c < ADC_CHANNELS; c++) {
+        winSum[c] += v.ch[c];
+        if (v.ch[c] < winMin[c]) winMin[c] = v.ch[c];
+        if (v.ch[c] > winMax[c]) winMax[c] = v.ch[c];
+    }
+    if (++winCount < decim) return false;
+
+    // window complete: average, smooth and publish
+    for (uint8_t c = 0; c < ADC_CHANNELS; c++) {
+        uint32_t mean = winSum[c] / winCount;
+        if (publishedCount == 0) {
+            filtered[c] = mean << ADC_IIR_SHIFT;
+        } else {
+            filtered[c] += mean - (filtered[c] >> ADC_IIR_SHIFT);
+        }
+    }
+
+    AdcReading reading;
+    for (uint8_t c = 0; c < ADC_CHANNELS; c++) {
+        reading.value[c] = filtered[c] >> ADC_IIR_SHIFT;
+        reading.min[c]   = winMin[c];
+        reading.max[c]   = winMax[c];
+    }
+    reading.timestamp = nowMs;
+    reading.count     = ++publishedCount;
+    published.write(reading);
+
+    resetWindow();
+    return true;
+}
+
+bool AdcPipeline::latest(AdcReading &out) const {
+    published.read(out);
+    return out.count != 0;
+}
+
+bool AdcPipeline::raw(uint32_t index, AdcSample &sample) const {
+    // at an age of ADC_RING_LEN the slot is the one being written next
+    uint32_t age = head() - index;
+    if (age == 0 || age >= ADC_RING_LEN) return false;
+    sample = ring[index & (ADC_RING_LEN - 1)];
+    // the writer may have lapped the reader while we copied
+    return head() - index < ADC_RING_LEN;
+}
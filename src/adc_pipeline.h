@@ -0,0 +1,76 @@
+#ifndef ADC_PIPELINE_H_
+#define ADC_PIPELINE_H_
+
+#include <stdint.h>
+#include <atomic>
+#include "seqlock.h"
+
+// ----------------------------------------------------------------------------
+// ADC sample pipeline
+// ----------------------------------------------------------------------------
+//
+// The part of the sampling pipeline after the conversion, see adc_sampler.h
+// for the timer and task around it. Raw samples go into a lock-free ring
+// that any number of readers can follow with their own index. Every
+// 'decimation' samples the window is averaged, smoothed with a single-pole
+// IIR and published together with the window min/max and a timestamp;
+// readers get a consistent copy through a seqlock.
+//
+// No Arduino dependencies, builds on the host as well.
+
+#define ADC_DECIMATION      20      // raw samples per published reading (100 Hz)
+#define ADC_RING_LEN        512     // raw sample history, must be a power of two
+#define ADC_IIR_SHIFT       2       // IIR weight of a new window is 1 / 2^shift
+#define ADC_CHANNELS        2
+
+#define ADC_CH_FWD          0
+#define ADC_CH_REF          1
+
+struct AdcSample {
+    uint16_t ch[ADC_CHANNELS];
+};
+
+struct AdcReading {
+    uint16_t value[ADC_CHANNELS];   // decimated and filtered
+    uint16_t min[ADC_CHANNELS];     // raw extremes of the last window
+    uint16_t max[ADC_CHANNELS];
+    uint32_t timestamp;     // millis() at the end of the window
+    uint32_t count;         // readings published so far
+};
+
+class AdcPipeline {
+public:
+    void begin(uint16_t decimation = ADC_DECIMATION);
+
+    // One raw sample from the single writer, nowMs becomes the timestamp of
+    // a reading it completes. Returns true when it published one.
+    bool push(const AdcSample &sample, uint32_t nowMs);
+
+    // Latest published reading, false until the first window completes.
+    bool latest(AdcReading &out) const;
+
+    // Raw ring access: head() is the index the next sample will get. A raw
+    // sample can be read while head() - index < ADC_RING_LEN.
+    uint32_t head() const { return ringHead.load(std::memory_order_acquire); }
+    bool raw(uint32_t index, AdcSample &sample) const;
+
+private:
+    uint16_t  decim = ADC_DECIMATION;
+
+    AdcSample ring[ADC_RING_LEN];
+    std::atomic<uint32_t> ringHead{0};
+
+    // decimation window, only touched by the writer
+    uint32_t winSum[ADC_CHANNELS];
+    uint16_t winMin[ADC_CHANNELS];
+    uint16_t winMax[ADC_CHANNELS];
+    uint16_t winCount = 0;
+    uint32_t filtered[ADC_CHANNELS];    // IIR state, scaled by 2^ADC_IIR_SHIFT
+
+    void resetWindow();
+
+    uint32_t publishedCount = 0;
+    Seqlock<AdcReading> published;
+};
+
+#endif /* ADC_PIPELINE_H_ */
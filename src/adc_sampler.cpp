@@ -0,0 +1,43 @@
+#include "adc_sampler.h"
+
+bool AdcSampler::begin(AdcSource source, void *ctx, uint32_t sampleHz, uint16_t decimation,
+                       BaseType_t core, UBaseType_t priority) {
+    src    = source;
+    srcCtx = ctx;
+    rate   = sampleHz;
+    pipeline.begin(decimation);
+
+    if (xTaskCreatePinnedToCore(taskEntry, "adc", 3072, this, priority, &task, core) != pdPASS) {
+        return false;
+    }
+
+    esp_timer_create_args_t args = {};
+    args.callback        = onTimer;
+    args.arg             = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name            = "adc";
+    if (esp_timer_create(&args, &timer) != ESP_OK) return false;
+    return esp_timer_start_periodic(timer, 1000000UL / rate) == ESP_OK;
+}
+
+void AdcSampler::onTimer(void *arg) {
+    xTaskNotifyGive(static_cast<AdcSampler *>(arg)->task);
+}
+
+void AdcSampler::taskEntry(void *arg) {
+    AdcSampler *self = static_cast<AdcSampler *>(arg);
+    for (;;) {
+        // more than one pending tick means the task fell behind the timer
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (ticks > 1) self->missed += ticks - 1;
+        self->sample();
+    }
+}
+
+void AdcSampler::sample() {
+    AdcSample v;
+    uint32_t t = micros();
+    src(srcCtx, v.ch);
+    if (sampleHook) sampleHook(v, t, hookCtx);
+    pipeline.push(v, millis());
+}
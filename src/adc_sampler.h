@@ -0,0 +1,72 @@
+#ifndef ADC_SAMPLER_H_
+#define ADC_SAMPLER_H_
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "adc_pipeline.h"
+
+// ----------------------------------------------------------------------------
+// Background ADC sampling pipeline
+// ----------------------------------------------------------------------------
+//
+// A periodic esp_timer wakes a sampler task that takes one raw sample per
+// period, so the sampling rate no longer depends on how fast loop() runs.
+// The samples go through an AdcPipeline (adc_pipeline.h): a raw ring, and
+// decimated, filtered readings with min/max and a timestamp.
+//
+// Every tick samples all ADC_CHANNELS channels: the forward and reflected
+// outputs of the SWR bridge detector. The forward detector sits on GPIO16,
+// which is ADC2 on the ESP32-S3. ADC2 is not available to the DMA continuous
+// mode on this chip, so each sample is a one-shot conversion paced by the
+// timer instead.
+//
+// Samples come from an AdcSource callback, so a simulated source can drive
+// the pipeline, and sample() can be stepped directly without the task. A
+// sample hook sees every raw sample in the sampler task, before it is
+// buffered, for checks that cannot wait for a published reading.
+
+#define ADC_SAMPLE_HZ       2000    // raw sampling rate
+
+// fills values[0..ADC_CHANNELS-1]
+typedef void (*AdcSource)(void *ctx, uint16_t *values);
+
+// sampledAt is micros() taken just before the conversion
+typedef void (*AdcSampleHook)(const AdcSample &sample, uint32_t sampledAt, void *ctx);
+
+class AdcSampler {
+public:
+    bool begin(AdcSource source, void *ctx,
+               uint32_t sampleHz = ADC_SAMPLE_HZ, uint16_t decimation = ADC_DECIMATION,
+               BaseType_t core = 0, UBaseType_t priority = 5);
+
+    // Set before begin(), runs in the sampler task and must be short.
+    void onSample(AdcSampleHook hook, void *ctx) { sampleHook = hook; hookCtx = ctx; }
+
+    // Takes one raw sample, called by the sampler task on every tick.
+    void sample();
+
+    // see AdcPipeline
+    bool latest(AdcReading &out) const { return pipeline.latest(out); }
+    uint32_t head() const { return pipeline.head(); }
+    bool raw(uint32_t index, AdcSample &sample) const { return pipeline.raw(index, sample); }
+
+    uint32_t sampleRate() const { return rate; }
+    uint32_t missedTicks() const { return missed; }
+
+private:
+    static void onTimer(void *arg);
+    static void taskEntry(void *arg);
+
+    AdcSource src = NULL;
+    void     *srcCtx = NULL;
+    AdcSampleHook sampleHook = NULL;
+    void     *hookCtx = NULL;
+    uint32_t  rate = ADC_SAMPLE_HZ;
+    TaskHandle_t task = NULL;
+    esp_timer_handle_t timer = NULL;
+    uint32_t  missed = 0;
+
+    AdcPipeline pipeline;
+};
+
+#endif /* ADC_SAMPLER_H_ */
@@ -0,0 +1,103 @@
+#include "antenna_scan.h"
+
+void AntennaScan::start(uint8_t returnDir, uint16_t settleMs, uint32_t now) {
+    returnTo  = returnDir;
+    settle    = settleMs;
+    startedAt = now;
+    count     = 0;
+    finished  = false;
+    dir       = 1;
+    enter(State::SWITCH, now);
+}
+
+void AntennaScan::abort(uint8_t reason, uint8_t endDir, uint32_t now) {
+    if (!running()) return;
+    returnTo = endDir;
+    finish(reason, now);
+}
+
+void AntennaScan::enter(State s, uint32_t now) {
+    st = s;
+    switch (s) {
+        case State::SWITCH: deadline = now + SCAN_SWITCH_TIMEOUT_MS; break;
+        case State::SETTLE: deadline = now + settle;                 break;
+        case State::SAMPLE:
+            deadline = now + SCAN_WINDOW_MS;
+            swrSum   = 0;
+            swrMin   = 0xffff;
+            swrMax   = 0;
+            readings = 0;
+            break;
+        default: break;
+    }
+}
+
+void AntennaScan::finish(uint8_t status, uint32_t now) {
+    lastStatus     = status;
+    lastDurationMs = now - startedAt;
+    if (lastDurationMs > maxDurationMs) maxDurationMs = lastDurationMs;
+    sweepCount++;
+    dir      = returnTo;
+    st       = State::IDLE;
+    finished = true;
+}
+
+void AntennaScan::addReading(const SwrResult &m) {
+    if (st != State::SAMPLE || m.swrQ8 == 0 || readings == 0xff) return;
+    swrSum += m.swrQ8;
+    if (m.swrQ8 < swrMin) swrMin = m.swrQ8;
+    if (m.swrQ8 > swrMax) swrMax = m.swrQ8;
+    readings++;
+}
+
+bool AntennaScan::update(uint32_t now, uint8_t currentDir, bool relaysBusy) {
+    switch (st) {
+        case State::IDLE:
+            if (finished) {
+                finished = false;
+                return true;
+            }
+            return false;
+
+        case State::SWITCH:
+            if (currentDir == dir && !relaysBusy) {
+                enter(State::SETTLE, now);
+            } else if ((int32_t)(now - deadline) >= 0) {
+                finish(SCAN_ABORT_RELAY, now);
+            }
+            return false;
+
+        case State::SETTLE:
+            if ((int32_t)(now - deadline) >= 0) enter(State::SAMPLE, now);
+            return false;
+
+        case State::SAMPLE: {
+            if ((int32_t)(now - deadline) < 0) return false;
+
+            // insert into the ranking, lowest average SWR first, no signal last
+            ScanEntry e;
+            e.dir      = dir;
+            e.readings = readings;
+            e.swrAvg   = readings ? swrSum / readings : 0;
+            e.swrMin   = readings ? swrMin : 0;
+            e.swrMax   = swrMax;
+            uint8_t i = count;
+            while (i > 0 && e.readings &&
+                   (ranked[i - 1].readings == 0 || ranked[i - 1].swrAvg > e.swrAvg)) {
+                ranked[i] = ranked[i - 1];
+                i--;
+            }
+            ranked[i] = e;
+            count++;
+
+            if (dir >= SCAN_DIRECTIONS) {
+                finish(SCAN_DONE, now);
+            } else {
+                dir++;
+                enter(State::SWITCH, now);
+            }
+            return false;
+        }
+    }
+    return false;
+}
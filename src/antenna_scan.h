@@ -0,0 +1,99 @@
+#ifndef ANTENNA_SCAN_H_
+#define ANTENNA_SCAN_H_
+
+#include <stdint.h>
+#include "swr_calc.h"
+#include "ws_proto.h"
+
+// ----------------------------------------------------------------------------
+// Antenna scan
+// ----------------------------------------------------------------------------
+//
+// Steps through directions 1..SCAN_DIRECTIONS by handing each one out as the
+// wanted direction, so the relays are switched by the normal sequencer with
+// all its interlocks. At every position the scan waits until the relay is
+// confirmed, lets the contacts settle, then averages the SWR readings of one
+// SCAN_WINDOW_MS window. The results are ranked by average SWR, positions
+// without forward signal last.
+//
+// The scan measures with a low-level probe signal below the RF level of the
+// interlock. Real RF aborts it, as does the rotary switch, a direction command
+// or a relay that does not confirm within SCAN_SWITCH_TIMEOUT_MS. Every step
+// is bounded, so a full sweep takes at most
+//
+//   SCAN_DIRECTIONS * (SCAN_SWITCH_TIMEOUT_MS + settle + SCAN_WINDOW_MS)
+//
+// which is 8 * (200 + 20 + 100) ms = 2.56 s with the defaults. The actual
+// duration of each sweep is measured.
+//
+// Like the relay sequencer it runs against millis() deadlines from loop() and
+// never blocks.
+
+#define SCAN_DIRECTIONS         8
+#define SCAN_SWITCH_TIMEOUT_MS  200
+#define SCAN_WINDOW_MS          100
+
+#define SCAN_DONE               0
+#define SCAN_ABORT_ROTARY       1
+#define SCAN_ABORT_RF           2
+#define SCAN_ABORT_USER         3
+#define SCAN_ABORT_RELAY        4
+
+class AntennaScan {
+public:
+    enum class State : uint8_t { IDLE, SWITCH, SETTLE, SAMPLE };
+
+    // Starts a sweep, returnDir is selected again when it completes
+    void start(uint8_t returnDir, uint16_t settleMs, uint32_t now);
+
+    // Stops a running sweep and selects endDir instead of returnDir
+    void abort(uint8_t reason, uint8_t endDir, uint32_t now);
+
+    // Advances the sweep, returns true once when it completed or aborted
+    bool update(uint32_t now, uint8_t currentDir, bool relaysBusy);
+
+    // A new reading, only used while sampling
+    void addReading(const SwrResult &m);
+
+    bool    running()   const { return st != State::IDLE; }
+    State   state()     const { return st; }
+    // the direction the scan wants selected, valid while running and after
+    // update() reported the end
+    uint8_t direction() const { return dir; }
+    uint8_t returnDirection() const { return returnTo; }
+
+    // ranked results of the last sweep, an aborted one has fewer entries
+    uint8_t status()        const { return lastStatus; }
+    uint8_t resultCount()   const { return count; }
+    const ScanEntry &result(uint8_t i) const { return ranked[i]; }
+    uint32_t lastDuration() const { return lastDurationMs; }
+    uint32_t maxDuration()  const { return maxDurationMs; }
+    uint32_t sweeps()       const { return sweepCount; }
+
+private:
+    void enter(State s, uint32_t now);
+    void finish(uint8_t status, uint32_t now);
+
+    State    st         = State::IDLE;
+    uint8_t  dir        = 0;
+    uint8_t  returnTo   = 0;
+    uint16_t settle     = 0;
+    uint32_t startedAt  = 0;
+    uint32_t deadline   = 0;
+    bool     finished   = false;
+
+    // current window
+    uint32_t swrSum     = 0;
+    uint16_t swrMin     = 0;
+    uint16_t swrMax     = 0;
+    uint8_t  readings   = 0;
+
+    ScanEntry ranked[SCAN_DIRECTIONS];
+    uint8_t  count          = 0;
+    uint8_t  lastStatus     = SCAN_DONE;
+    uint32_t lastDurationMs = 0;
+    uint32_t maxDurationMs  = 0;
+    uint32_t sweepCount     = 0;
+};
+
+#endif /* ANTENNA_SCAN_H_ */
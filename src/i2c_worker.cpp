@@ -0,0 +1,195 @@
+#include "i2c_worker.h"
+#include "i2c_write_read.h"
+
+#define SLOT(i) ((i) & (I2C_QUEUE_LEN - 1))
+
+bool I2CWorker::begin(TwoWire &w, int sdaPin, int sclPin, const char *name,
+                      BaseType_t core, UBaseType_t priority) {
+    wire = &w;
+    sda  = sdaPin;
+    scl  = sclPin;
+    wire->setTimeOut(I2C_TIMEOUT_MS);
+    return xTaskCreatePinnedToCore(taskEntry, name, 4096, this, priority, &task, core) == pdPASS;
+}
+
+bool I2CWorker::submit(const I2CTransaction &t) {
+    bool ok = true;
+    portENTER_CRITICAL(&mux);
+    if (!t.read) {
+        // coalesce with a queued (not yet started) write to the same register
+        for (uint32_t i = head; i != tail; i++) {
+            I2CTransaction &q = slots[SLOT(i)];
+            if (!q.read && q.dev == t.dev && q.reg == t.reg && q.len == t.len
+                && q.verify == t.verify && q.cb == t.cb && q.ctx == t.ctx) {
+                memcpy(q.data, t.data, t.len);
+                coalescedCount++;
+                portEXIT_CRITICAL(&mux);
+                return true;
+            }
+        }
+    }
+    if (tail - doneHead >= I2C_QUEUE_LEN) {
+        rejectedCount++;
+        ok = false;
+    } else {
+        slots[SLOT(tail)] = t;
+        tail++;
+    }
+    portEXIT_CRITICAL(&mux);
+    if (ok) xTaskNotifyGive(task);
+    return ok;
+}
+
+bool I2CWorker::submitWrite(uint8_t dev, uint8_t reg, const uint8_t *data, uint8_t len,
+                            I2CCallback cb, void *ctx, bool verify) {
+    if (len > I2C_MAX_DATA) return false;
+    I2CTransaction t = {};
+    t.dev      = dev;
+    t.reg      = reg;
+    t.len      = len;
+    t.read     = false;
+    t.verify   = verify;
+    t.queuedAt = micros();
+    t.cb       = cb;
+    t.ctx      = ctx;
+    memcpy(t.data, data, len);
+    return submit(t);
+}
+
+bool I2CWorker::submitRead(uint8_t dev, uint8_t reg, uint8_t len, I2CCallback cb, void *ctx) {
+    if (len > I2C_MAX_DATA) return false;
+    I2CTransaction t = {};
+    t.dev      = dev;
+    t.reg      = reg;
+    t.len      = len;
+    t.read     = true;
+    t.queuedAt = micros();
+    t.cb       = cb;
+    t.ctx      = ctx;
+    return submit(t);
+}
+
+void I2CWorker::poll() {
+    while (doneHead != completed) {
+        I2CTransaction &t = slots[SLOT(doneHead)];
+        if (t.cb) t.cb(t, t.ctx);
+        portENTER_CRITICAL(&mux);
+        doneHead++;
+        portEXIT_CRITICAL(&mux);
+    }
+}
+
+void I2CWorker::taskEntry(void *arg) {
+    static_cast<I2CWorker *>(arg)->run();
+}
+
+void I2CWorker::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        runQueued();
+    }
+}
+
+void I2CWorker::runQueued() {
+    for (;;) {
+        portENTER_CRITICAL(&mux);
+        if (head == tail) {
+            portEXIT_CRITICAL(&mux);
+            break;
+        }
+        uint32_t idx = head++;
+        portEXIT_CRITICAL(&mux);
+
+        I2CTransaction &t = slots[SLOT(idx)];
+        execute(t);
+
+        uint32_t latency = micros() - t.queuedAt;
+        if (latency > maxLatencyUs) maxLatencyUs = latency;
+
+        portENTER_CRITICAL(&mux);
+        completed++;
+        portEXIT_CRITICAL(&mux);
+    }
+}
+
+I2CDeviceStats *I2CWorker::statsFor(uint8_t addr) {
+    for (uint8_t i = 0; i < statCount; i++) {
+        if (stats[i].addr == addr) return &stats[i];
+    }
+    if (statCount >= I2C_MAX_DEVICES) return NULL;
+    I2CDeviceStats &s = stats[statCount];
+    s = {};
+    s.addr = addr;
+    statCount++;
+    return &s;
+}
+
+void I2CWorker::execute(I2CTransaction &t) {
+    I2CDeviceStats *s = statsFor(t.dev);
+    uint32_t start = micros();
+
+    for (uint8_t attempt = 0; ; attempt++) {
+        t.status = transfer(t);
+        if (t.status == 0 || attempt >= I2C_RETRIES) break;
+        if (s) s->retries++;
+        if (t.status == I2C_ERR_VERIFY && s) s->verifyFailures++;
+        vTaskDelay(pdMS_TO_TICKS(I2C_BACKOFF_MS << attempt));
+    }
+
+    // a NACK only means the device did not answer, anything else may have
+    // left a slave holding SDA low
+    if (t.status != 0 && t.status != 2 && t.status != 3) recoverBus();
+
+    if (s) {
+        uint32_t latency = micros() - start;
+        s->transactions++;
+        s->lastLatencyUs = latency;
+        if (latency > s->maxLatencyUs) s->maxLatencyUs = latency;
+        if (t.status != 0) s->errors++;
+    }
+}
+
+uint8_t I2CWorker::transfer(I2CTransaction &t) {
+    if (t.read) return i2cWriteRead(*wire, t.dev, &t.reg, 1, t.data, t.len);
+
+    wire->beginTransmission(t.dev);
+    wire->write(t.reg);
+    wire->write(t.data, t.len);
+    uint8_t status = wire->endTransmission();
+    if (status != 0 || !t.verify) return status;
+
+    // read the registers back and compare
+    uint8_t check[I2C_MAX_DATA];
+    status = i2cWriteRead(*wire, t.dev, &t.reg, 1, check, t.len);
+    if (status != 0) return status;
+    return memcmp(check, t.data, t.len) == 0 ? 0 : I2C_ERR_VERIFY;
+}
+
+void I2CWorker::recoverBus() {
+    if (sda < 0 || scl < 0) return;
+    uint32_t frequency = wire->getClock();
+    wire->end();
+
+    // clock out whatever byte a slave is still trying to send
+    pinMode(sda, INPUT_PULLUP);
+    pinMode(scl, OUTPUT_OPEN_DRAIN);
+    digitalWrite(scl, HIGH);
+    for (uint8_t i = 0; i < 9 && digitalRead(sda) == LOW; i++) {
+        digitalWrite(scl, LOW);
+        delayMicroseconds(5);
+        digitalWrite(scl, HIGH);
+        delayMicroseconds(5);
+    }
+
+    // STOP condition: SDA rises while SCL is high
+    pinMode(sda, OUTPUT_OPEN_DRAIN);
+    digitalWrite(sda, LOW);
+    delayMicroseconds(5);
+    digitalWrite(scl, HIGH);
+    delayMicroseconds(5);
+    digitalWrite(sda, HIGH);
+    delayMicroseconds(5);
+
+    wire->begin(sda, scl, frequency);
+    recoveryCount++;
+}
@@ -0,0 +1,131 @@
+#ifndef I2C_WORKER_H_
+#define I2C_WORKER_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// ----------------------------------------------------------------------------
+// I2C worker task
+// ----------------------------------------------------------------------------
+//
+// Once started, the worker task owns the bus: loop() only queues register
+// transactions and never waits for the bus. Completed transactions are handed
+// back through poll(), which runs the completion callbacks in the caller's
+// context, so callbacks can touch loop() state without locking.
+//
+// A write that targets the same device/register as a still-queued write with
+// the same callback replaces its data instead of queueing another transfer.
+//
+// Failed transfers are retried up to I2C_RETRIES times with an exponential
+// backoff. When a transfer still fails with a bus error or timeout, the bus is
+// recovered by clocking SCL until the stuck slave releases SDA and sending a
+// STOP. Writes flagged for verification are read back and compared.
+
+#define I2C_QUEUE_LEN       16      // must be a power of two
+#define I2C_MAX_DATA        4
+#define I2C_MAX_DEVICES     8       // devices with their own health counters
+#define I2C_RETRIES         3
+#define I2C_BACKOFF_MS      1       // doubled on every retry
+#define I2C_TIMEOUT_MS      50      // TwoWire timeout of each transfer, set by begin()
+
+// Bus recovery after a failed transaction: up to 9 SCL clocks of 10 us and a
+// STOP of 15 us (about 0.1 ms), then wire->end() and wire->begin() to
+// reinstall the driver, well under a millisecond together
+#define I2C_RECOVERY_MS     1
+
+// Bus time of one transaction in the worst case: every attempt times out on
+// the write and on the read-back, plus the backoffs and a bus recovery
+#define I2C_WORST_CASE_MS   ((I2C_RETRIES + 1) * 2 * I2C_TIMEOUT_MS \
+                             + (I2C_BACKOFF_MS << I2C_RETRIES) - I2C_BACKOFF_MS + I2C_RECOVERY_MS)
+
+#define I2C_ERR_VERIFY      6       // status of a write whose read-back differs
+
+struct I2CDeviceStats {
+    uint8_t  addr;
+    uint32_t transactions;
+    uint32_t errors;            // transactions that failed after all retries
+    uint32_t retries;
+    uint32_t verifyFailures;
+    uint32_t lastLatencyUs;     // bus time of the last transaction, retries included
+    uint32_t maxLatencyUs;
+};
+
+struct I2CTransaction;
+typedef void (*I2CCallback)(const I2CTransaction &t, void *ctx);
+
+struct I2CTransaction {
+    uint8_t     dev;
+    uint8_t     reg;
+    uint8_t     len;
+    bool        read;
+    uint8_t     data[I2C_MAX_DATA];
+    bool        verify;         // read a write back and compare
+    uint8_t     status;         // endTransmission() code, 0 = success
+    uint32_t    queuedAt;       // micros() at submit
+    I2CCallback cb;
+    void       *ctx;
+};
+
+class I2CWorker {
+public:
+    // sda/scl are needed to recover a stuck bus
+    bool begin(TwoWire &wire, int sda, int scl, const char *name = "i2c",
+               BaseType_t core = 1, UBaseType_t priority = 2);
+
+    // Queue a transaction, return false if the queue is full.
+    bool submitWrite(uint8_t dev, uint8_t reg, const uint8_t *data, uint8_t len,
+                     I2CCallback cb = NULL, void *ctx = NULL, bool verify = false);
+    bool submitRead(uint8_t dev, uint8_t reg, uint8_t len, I2CCallback cb, void *ctx = NULL);
+
+    // Runs the callbacks of completed transactions, call from loop().
+    void poll();
+
+    // Executes the queued transactions, called by the worker task when it is
+    // notified.
+    void runQueued();
+
+    // number of transactions not yet handed back by poll()
+    uint8_t  outstanding() const { return tail - doneHead; }
+    uint32_t coalesced()   const { return coalescedCount; }
+    uint32_t rejected()    const { return rejectedCount; }
+    uint32_t maxLatency()  const { return maxLatencyUs; }   // submit to completion
+    uint32_t recoveries()  const { return recoveryCount; }
+
+    // Health counters, written by the worker task. Individual counters can
+    // be read from any task, a set of them is not a consistent snapshot.
+    uint8_t deviceCount() const { return statCount; }
+    const I2CDeviceStats &deviceStats(uint8_t i) const { return stats[i]; }
+
+private:
+    static void taskEntry(void *arg);
+    void run();
+    void execute(I2CTransaction &t);
+    uint8_t transfer(I2CTransaction &t);
+    void recoverBus();
+    I2CDeviceStats *statsFor(uint8_t addr);
+    bool submit(const I2CTransaction &t);
+
+    TwoWire     *wire = NULL;
+    int          sda  = -1;
+    int          scl  = -1;
+    TaskHandle_t task = NULL;
+    portMUX_TYPE mux  = portMUX_INITIALIZER_UNLOCKED;
+
+    // Slots [doneHead, completed) are finished and wait for poll(),
+    // [completed, head) are on the bus, [head, tail) are queued.
+    I2CTransaction slots[I2C_QUEUE_LEN];
+    volatile uint32_t doneHead  = 0;
+    volatile uint32_t completed = 0;
+    volatile uint32_t head      = 0;
+    volatile uint32_t tail      = 0;
+
+    uint32_t coalescedCount = 0;
+    uint32_t rejectedCount  = 0;
+    volatile uint32_t maxLatencyUs = 0;
+
+    I2CDeviceStats stats[I2C_MAX_DEVICES];
+    volatile uint8_t statCount = 0;
+    uint32_t recoveryCount = 0;
+};
+
+#endif /* I2C_WORKER_H_ */
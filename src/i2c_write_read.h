@@ -0,0 +1,31 @@
+#ifndef I2C_WRITE_READ_H_
+#define I2C_WRITE_READ_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ----------------------------------------------------------------------------
+// Write-then-read with a repeated start
+// ----------------------------------------------------------------------------
+//
+// Sends tx (usually a register pointer) without a STOP and reads rxLen bytes
+// into rx, using only the public TwoWire API, so any Wire-like class works.
+// The framework keeps the bus lock from endTransmission(false) until
+// requestFrom() finishes, so nothing else gets between the two. Returns the
+// endTransmission() status, or 4 when the read came back short.
+
+template <typename WireType>
+uint8_t i2cWriteRead(WireType &wire, uint8_t addr, const uint8_t *tx, size_t txLen,
+                     uint8_t *rx, size_t rxLen) {
+    wire.beginTransmission(addr);
+    wire.write(tx, txLen);
+    uint8_t status = wire.endTransmission(false);
+    if (status != 0) return status;
+
+    size_t n = wire.requestFrom(addr, rxLen, true);
+    size_t count = 0;
+    while (count < n && count < rxLen && wire.available()) rx[count++] = wire.read();
+    return count == rxLen ? 0 : 4;
+}
+
+#endif
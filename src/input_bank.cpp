@@ -0,0 +1,41 @@
+#include "input_bank.h"
+
+void InputBank::begin(uint32_t initial, uint32_t hold, uint16_t longT, uint16_t repeatT) {
+    debounced   = initial;
+    ct0         = 0xffffffff;
+    ct1         = 0xffffffff;
+    holdMask    = hold;
+    longTicks   = longT;
+    repeatTicks = repeatT;
+    for (uint8_t i = 0; i < INPUT_BANK_BITS; i++) heldFor[i] = 0;
+    ev = {};
+}
+
+const InputEvents &InputBank::tick(uint32_t sample) {
+    // count down the inputs that differ, reset the others to 3, toggle the
+    // ones whose counter wrapped
+    uint32_t delta = sample ^ debounced;
+    ct0 = ~(ct0 & delta);
+    ct1 = ct0 ^ (ct1 & delta);
+    delta &= ct0 & ct1;
+    debounced ^= delta;
+    tickCount++;
+
+    ev.pressed   = delta & debounced;
+    ev.released  = delta & ~debounced;
+    ev.longPress = 0;
+    ev.held      = 0;
+    if (!longTicks) return ev;
+
+    for (uint32_t active = debounced & holdMask; active; active &= active - 1) {
+        uint8_t i = __builtin_ctz(active);
+        if (ev.pressed & (1UL << i)) heldFor[i] = 0;
+        if (heldFor[i] < longTicks) {
+            if (++heldFor[i] == longTicks) ev.longPress |= 1UL << i;
+        } else if (repeatTicks && ++heldFor[i] == longTicks + repeatTicks) {
+            heldFor[i] = longTicks;
+            ev.held |= 1UL << i;
+        }
+    }
+    return ev;
+}
@@ -0,0 +1,59 @@
+#ifndef INPUT_BANK_H_
+#define INPUT_BANK_H_
+
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+// Debounced digital input bank
+// ----------------------------------------------------------------------------
+//
+// All digital inputs are sampled together into one bitmask per tick (bit set
+// = input active) and debounced in parallel with a two-bit vertical counter:
+// bit n of ct0/ct1 is the counter of input n, so every tick costs the same
+// few word operations whatever the number of inputs. An input takes a new
+// state after INPUT_DEBOUNCE_TICKS consecutive samples that differ from the
+// debounced one, any sample that agrees again restarts its count.
+//
+// tick() returns the events of that tick as masks. Inputs in the hold mask
+// also get a long press once they have been held for the long-press time,
+// then a held event every repeat time until released. Only the inputs that
+// are held cost a counter update.
+//
+// Arduino-free, the caller samples the pins and owns the tick.
+
+#define INPUT_BANK_BITS         32
+#define INPUT_DEBOUNCE_TICKS    4       // fixed by the two-bit counter
+
+struct InputEvents {
+    uint32_t pressed;       // became active
+    uint32_t released;      // became inactive
+    uint32_t longPress;     // active for the long-press time, once per press
+    uint32_t held;          // every repeat time after the long press
+};
+
+class InputBank {
+public:
+    // initial is taken as debounced as is. longTicks and repeatTicks apply
+    // to the inputs in holdMask, 0 disables the event.
+    void begin(uint32_t initial, uint32_t holdMask = 0, uint16_t longTicks = 0, uint16_t repeatTicks = 0);
+
+    // One debounce step with the raw sample, returns the events of this tick.
+    const InputEvents &tick(uint32_t sample);
+
+    uint32_t state()  const { return debounced; }
+    uint32_t ticks()  const { return tickCount; }
+    const InputEvents &events() const { return ev; }
+
+private:
+    uint32_t debounced = 0;
+    uint32_t ct0 = 0xffffffff;            // counters idle at 3
+    uint32_t ct1 = 0xffffffff;
+    uint32_t holdMask = 0;
+    uint16_t longTicks = 0;
+    uint16_t repeatTicks = 0;
+    uint16_t heldFor[INPUT_BANK_BITS] = {};
+    uint32_t tickCount = 0;
+    InputEvents ev = {};
+};
+
+#endif /* INPUT_BANK_H_ */
@@ -0,0 +1,110 @@
+#include "ioex_bus.h"
+
+int8_t IoExBus::addDevice(TwoWire &wire, I2CWorker &worker, uint8_t addr, uint16_t inputMask) {
+    if (count >= IOEX_MAX_DEVICES) return -1;
+    Device &d = dev[count];
+    d.worker = &worker;
+    d.addr   = addr;
+    d.inputs = inputMask;
+    d.staged = 0;
+    d.sent   = 0;
+    d.acked  = 0;
+    d.reconfig = false;
+    d.failed   = false;
+    d.io.attach(wire);
+    d.io.setDeviceAddress(addr);
+    return count++;
+}
+
+bool IoExBus::begin() {
+    bool ok = true;
+    for (uint8_t i = 0; i < count; i++) {
+        Device &d = dev[i];
+        if (!d.io.sync()) {
+            Serial.printf("TCA9539 0x%02x register sync failed\n", d.addr);
+            ok = false;
+        }
+        ok = d.io.output16(0) && ok;    // relays off before the pins become outputs
+        ok = d.io.config16(d.inputs) && ok;
+    }
+    return ok;
+}
+
+void IoExBus::setPin(uint16_t pin, bool level) {
+    if (pin >= pinCount()) return;
+    Device &d = dev[pin / IOEX_PINS_PER_DEV];
+    uint16_t bit = 1 << (pin % IOEX_PINS_PER_DEV);
+    d.staged = level ? (d.staged | bit) : (d.staged & ~bit);
+}
+
+bool IoExBus::pin(uint16_t pin) const {
+    if (pin >= pinCount()) return false;
+    return dev[pin / IOEX_PINS_PER_DEV].staged & (1 << (pin % IOEX_PINS_PER_DEV));
+}
+
+void IoExBus::setWord(uint8_t device, uint16_t value) {
+    if (device < count) dev[device].staged = value;
+}
+
+bool IoExBus::commit() {
+    bool ok = true;
+    for (uint8_t i = 0; i < count; i++) {
+        Device &d = dev[i];
+        if (d.staged == d.sent) continue;
+        d.failed = false;
+
+        if (d.reconfig) {
+            // same directions as in begin()
+            uint8_t cfg[2] = { (uint8_t)d.inputs, (uint8_t)(d.inputs >> 8) };
+            if (d.worker->submitWrite(d.addr, (uint8_t)TCA9539::Reg::CONFIG1, cfg, 2, onConfigured, &d, true)) {
+                d.reconfig = false;
+                txCount++;
+            }
+        }
+
+        uint8_t data[2] = { (uint8_t)d.staged, (uint8_t)(d.staged >> 8) };
+        if (d.worker->submitWrite(d.addr, (uint8_t)TCA9539::Reg::OUTPUT_PORT1, data, 2, onWritten, &d, true)) {
+            d.sent = d.staged;
+            txCount++;
+        } else {
+            d.failed = true;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+void IoExBus::onWritten(const I2CTransaction &t, void *ctx) {
+    // Writes queued back to back may be merged by the worker, so completion
+    // is tracked by value rather than by counting callbacks.
+    Device  &d    = *static_cast<Device *>(ctx);
+    uint16_t word = t.data[0] | (t.data[1] << 8);
+    if (t.status != 0) {
+        d.failed   = true;
+        d.sent     = ~d.staged;     // force a rewrite on the next commit
+        d.reconfig = true;
+        return;
+    }
+    d.acked = word;
+}
+
+void IoExBus::onConfigured(const I2CTransaction &t, void *ctx) {
+    Device &d = *static_cast<Device *>(ctx);
+    if (t.status != 0) d.reconfig = true;
+}
+
+int8_t IoExBus::commitResult() const {
+    int8_t result = 1;
+    for (uint8_t i = 0; i < count; i++) {
+        int8_t r = commitResult(i);
+        if (r < result) result = r;
+    }
+    return result;
+}
+
+int8_t IoExBus::commitResult(uint8_t device) const {
+    if (device >= count) return -1;
+    const Device &d = dev[device];
+    if (d.failed) return -1;
+    return d.acked == d.sent ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+#ifndef IOEX_BUS_H_
+#define IOEX_BUS_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "tca9539.h"
+#include "i2c_worker.h"
+
+// ----------------------------------------------------------------------------
+// Multi-expander output bus
+// ----------------------------------------------------------------------------
+//
+// Owns up to IOEX_MAX_DEVICES TCA9539 expanders spread over Wire and Wire1 and
+// presents their outputs as one flat pin space: device n (in the order of
+// addDevice()) holds logical pins 16*n .. 16*n+15. Pin changes are staged and
+// commit() sends one 16-bit write per changed device to the worker of the bus
+// it sits on, so each bus has at most one transaction per device in flight
+// and the two buses transfer in parallel.
+//
+// Each device has its own direction mask, pins set in it stay inputs (a 1 in
+// the TCA9539 CONFIG registers) and are left to e.g. IoExInput; their staged
+// output bits have no effect.
+//
+// Output writes are read back by the worker. When a device fails or reads
+// back wrong, its CONFIG registers are rewritten with that mask together with
+// the outputs on the next commit, in case the expander was reset under RF.
+
+#define IOEX_MAX_DEVICES    8
+#define IOEX_PINS_PER_DEV   16
+
+class IoExBus {
+public:
+    // Registers an expander, returns its device index or -1 if full. Pins
+    // set in inputMask are inputs, all others outputs.
+    int8_t addDevice(TwoWire &wire, I2CWorker &worker, uint8_t addr, uint16_t inputMask = 0);
+
+    // Synchronously loads the register cache of every device, drives all
+    // outputs low and applies the direction masks. Call before the workers
+    // take over the buses.
+    bool begin();
+
+    uint8_t  devices()  const { return count; }
+    uint16_t pinCount() const { return count * IOEX_PINS_PER_DEV; }
+
+    // staging, nothing is sent until commit()
+    void     setPin(uint16_t pin, bool level);
+    bool     pin(uint16_t pin) const;
+    void     setWord(uint8_t device, uint16_t value);
+    uint16_t word(uint8_t device) const { return dev[device].staged; }
+
+    // Queues the changed devices, returns false if a worker queue was full.
+    bool commit();
+
+    // 1 = last commit acknowledged by all devices, 0 = in progress, -1 = error
+    int8_t commitResult() const;
+    // the same for one device, a failure of another device does not count
+    int8_t commitResult(uint8_t device) const;
+
+    TCA9539 &expander(uint8_t device) { return dev[device].io; }
+    uint32_t transactions() const { return txCount; }
+
+private:
+    struct Device {
+        TCA9539    io;
+        I2CWorker *worker;
+        uint8_t    addr;
+        uint16_t   inputs;      // CONFIG value, 1 = input
+        uint16_t   staged;      // wanted output state
+        uint16_t   sent;        // last state handed to the worker
+        uint16_t   acked;       // last state the device acknowledged
+        bool       reconfig;    // rewrite CONFIG before the next output write
+        bool       failed;      // the last write of staged was rejected or failed
+    };
+
+    static void onWritten(const I2CTransaction &t, void *ctx);
+    static void onConfigured(const I2CTransaction &t, void *ctx);
+
+    Device   dev[IOEX_MAX_DEVICES];
+    uint8_t  count    = 0;
+    uint32_t txCount  = 0;
+};
+
+#endif /* IOEX_BUS_H_ */
@@ -0,0 +1,81 @@
+#include "ioex_input.h"
+#include "tca9539.h"
+
+bool IoExInput::begin(I2CWorker &w, uint8_t address, uint8_t pin) {
+    worker = &w;
+    dev    = address;
+    intPin = pin;
+    pinMode(intPin, INPUT_PULLUP);
+    attachInterruptArg(digitalPinToInterrupt(intPin), onInterrupt, this, FALLING);
+
+    // the first read only loads the current input state
+    irqAt = micros();
+    dirty = true;
+    return true;
+}
+
+bool IoExInput::subscribe(uint16_t mask, IoExEdgeCallback cb, void *ctx) {
+    if (subCount >= IOEX_MAX_SUBSCRIBERS) return false;
+    subs[subCount++] = { mask, cb, ctx };
+    return true;
+}
+
+void IRAM_ATTR IoExInput::onInterrupt(void *arg) {
+    IoExInput *self = static_cast<IoExInput *>(arg);
+    if (!self->dirty) {
+        self->irqAt = micros();
+        self->dirty = true;
+    }
+}
+
+void IoExInput::update() {
+    if (!dirty || inFlight) return;
+
+    dirty     = false;
+    readIrqAt = irqAt;
+    if (!worker->submitRead(dev, (uint8_t)TCA9539::Reg::INPUT_PORT1, 2, onRead, this)) {
+        dirty = true;   // queue full, try again on the next pass
+        return;
+    }
+    inFlight = true;
+}
+
+void IoExInput::onRead(const I2CTransaction &t, void *ctx) {
+    static_cast<IoExInput *>(ctx)->resolve(t);
+}
+
+void IoExInput::resolve(const I2CTransaction &t) {
+    inFlight = false;
+    if (t.status != 0) {
+        // INT stays asserted until the inputs are read, so retry
+        dirty = true;
+        return;
+    }
+    readCount++;
+
+    // a change during the read left INT low without a new edge
+    if (!dirty && digitalRead(intPin) == LOW) {
+        irqAt = micros();
+        dirty = true;
+    }
+
+    uint16_t now     = t.data[0] | (t.data[1] << 8);
+    uint16_t changed = primed ? now ^ last : 0xffff;
+    bool     first   = !primed;
+    last   = now;
+    primed = true;
+    if (!changed) return;
+
+    for (uint8_t s = 0; s < subCount; s++) {
+        uint16_t bits = changed & subs[s].mask;
+        for (uint8_t pin = 0; bits; pin++, bits >>= 1) {
+            if (bits & 1) subs[s].cb(pin, (now >> pin) & 1, subs[s].ctx);
+        }
+    }
+    if (first) return;
+    eventCount++;
+
+    uint32_t latency = micros() - readIrqAt;
+    lastLatencyUs = latency;
+    if (latency > maxLatencyUs) maxLatencyUs = latency;
+}
@@ -0,0 +1,78 @@
+#ifndef IOEX_INPUT_H_
+#define IOEX_INPUT_H_
+
+#include <Arduino.h>
+#include "i2c_worker.h"
+
+// ----------------------------------------------------------------------------
+// Interrupt-driven TCA9539 input change detection
+// ----------------------------------------------------------------------------
+//
+// The expander pulls its open-drain INT line low when an input differs from
+// the last value read. The GPIO interrupt only marks the expander dirty;
+// update() then queues a single 16-bit read of both input ports on the I2C
+// worker and the completion compares it against the previous value and
+// reports every changed pin to its subscribers. Nothing is read from the bus
+// while the inputs are quiet.
+//
+// INT is only released by the read, so an input that changes while the read
+// is in flight keeps it low without a new falling edge. After every read the
+// line is checked again and another read queued while it is still low. The
+// first read reports the level of every pin, so subscribers start from the
+// actual state.
+
+#define IOEX_MAX_SUBSCRIBERS 8
+
+typedef void (*IoExEdgeCallback)(uint8_t pin, bool level, void *ctx);
+
+class IoExInput {
+public:
+    // pin numbers are 0..15, PORT1 pins 0..7, PORT2 pins 8..15
+    bool begin(I2CWorker &worker, uint8_t dev, uint8_t intPin);
+
+    // cb is called for each edge on a pin whose bit is set in mask
+    bool subscribe(uint16_t mask, IoExEdgeCallback cb, void *ctx = NULL);
+
+    // Queues the input read after an interrupt, call from loop().
+    void update();
+
+    uint16_t inputs() const { return last; }
+
+    // interrupt-to-callback latency in microseconds
+    uint32_t lastLatency() const { return lastLatencyUs; }
+    uint32_t maxLatency()  const { return maxLatencyUs; }
+    uint32_t events()      const { return eventCount; }
+    uint32_t reads()       const { return readCount; }
+
+private:
+    static void IRAM_ATTR onInterrupt(void *arg);
+    static void onRead(const I2CTransaction &t, void *ctx);
+    void resolve(const I2CTransaction &t);
+
+    struct Subscriber {
+        uint16_t         mask;
+        IoExEdgeCallback cb;
+        void            *ctx;
+    };
+
+    I2CWorker *worker = NULL;
+    uint8_t    dev    = 0;
+    uint8_t    intPin = 0;
+
+    volatile bool     dirty = false;
+    volatile uint32_t irqAt = 0;       // micros() of the first unhandled interrupt
+    bool     inFlight  = false;
+    bool     primed    = false;       // false until the first read set 'last'
+    uint32_t readIrqAt = 0;
+    uint16_t last      = 0;
+
+    Subscriber subs[IOEX_MAX_SUBSCRIBERS];
+    uint8_t    subCount = 0;
+
+    uint32_t lastLatencyUs = 0;
+    uint32_t maxLatencyUs  = 0;
+    uint32_t eventCount    = 0;
+    uint32_t readCount     = 0;
+};
+
+#endif /* IOEX_INPUT_H_ */
@@ -0,0 +1,84 @@
+#include "job_sched.h"
+
+static const uint16_t HIST_BOUNDS[SCHED_HIST_BUCKETS - 1] = {
+    50, 100, 200, 500, 1000, 2000, 5000
+};
+
+uint16_t JobScheduler::histogramBound(uint8_t bucket) {
+    return bucket < SCHED_HIST_BUCKETS - 1 ? HIST_BOUNDS[bucket] : 0xffff;
+}
+
+bool JobScheduler::add(const char *name, JobFn fn, void *ctx, uint16_t periodMs, uint16_t budgetUs) {
+    if (count >= SCHED_MAX_JOBS) return false;
+    Job &job = jobs[count];
+    job = {};
+    job.fn             = fn;
+    job.ctx            = ctx;
+    job.stats.name     = name;
+    job.stats.periodMs = periodMs ? periodMs : 1;
+    job.stats.budgetUs = budgetUs;
+    count++;
+    return true;
+}
+
+uint32_t JobScheduler::runDue(uint32_t nowMs) {
+    uint32_t wait = 0xffffffff;
+    for (uint8_t i = 0; i < count; i++) {
+        Job &job = jobs[i];
+        if (!job.started) {
+            // the first release is the first call
+            job.started = true;
+            job.release = nowMs;
+        }
+        int32_t until = (int32_t)(job.release - nowMs);
+        if (until <= 0) {
+            runJob(job, nowMs);
+            until = (int32_t)(job.release - nowMs);
+        }
+        if ((uint32_t)until < wait) wait = until;
+    }
+    return count ? wait : 0;
+}
+
+void JobScheduler::runJob(Job &job, uint32_t nowMs) {
+    JobStats &s = job.stats;
+    uint32_t late = nowMs - job.release;
+    if (late > s.maxLateMs) s.maxLateMs = late;
+
+    uint32_t start = micros();
+    job.fn(job.ctx);
+    uint32_t took = micros() - start;
+
+    s.runs++;
+    s.lastUs = took;
+    if (took > s.maxUs) s.maxUs = took;
+    if (took > s.budgetUs) s.overruns++;
+    uint8_t b = 0;
+    while (b < SCHED_HIST_BUCKETS - 1 && took >= HIST_BOUNDS[b]) b++;
+    s.hist[b]++;
+
+    if (late >= s.periodMs) {
+        // no catching up, the next release is one period from now
+        s.missed += late / s.periodMs;
+        job.release = nowMs + s.periodMs;
+    } else {
+        job.release += s.periodMs;
+    }
+}
+
+bool JobScheduler::begin(const char *name, BaseType_t core, UBaseType_t priority, uint32_t stackSize) {
+    return xTaskCreatePinnedToCore(taskEntry, name, stackSize, this, priority, &task, core) == pdPASS;
+}
+
+void JobScheduler::taskEntry(void *arg) {
+    JobScheduler *self = static_cast<JobScheduler *>(arg);
+    for (;;) {
+        uint32_t wait = self->runDue(millis());
+        // a tick delay can end just before the release, runDue() then
+        // sleeps for the rest
+        TickType_t ticks = pdMS_TO_TICKS(wait);
+        uint32_t before = millis();
+        vTaskDelay(ticks ? ticks : 1);
+        self->idleTotal += millis() - before;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef JOB_SCHED_H_
+#define JOB_SCHED_H_
+
+#include <Arduino.h>
+
+// ----------------------------------------------------------------------------
+// Cooperative periodic scheduler
+// ----------------------------------------------------------------------------
+//
+// Jobs are registered with a period and an execution budget. runDue() runs
+// every job whose release has come, in the order the jobs were added, and
+// returns the time to the next release. A job that runs longer than its
+// budget counts as an overrun. A job that starts a whole period late skips
+// the releases it missed instead of running them back to back. Every run is
+// timed with micros() into a histogram per job.
+//
+// A scheduler either runs in its own task (begin()), which sleeps until the
+// next release, or is stepped from another task with its own clock, e.g.
+// one tick per cycle of a PeriodicTask. The counters are written by the
+// task that runs the jobs; individual counters can be read from any task,
+// a set of them is not a consistent snapshot.
+
+#define SCHED_MAX_JOBS      8
+#define SCHED_HIST_BUCKETS  8
+
+typedef void (*JobFn)(void *ctx);
+
+struct JobStats {
+    const char *name;
+    uint16_t periodMs;
+    uint16_t budgetUs;
+    uint32_t runs;
+    uint32_t overruns;          // runs over budget
+    uint32_t missed;            // releases skipped
+    uint32_t lastUs;
+    uint32_t maxUs;
+    uint32_t maxLateMs;         // start after the release
+    uint32_t hist[SCHED_HIST_BUCKETS];
+};
+
+class JobScheduler {
+public:
+    // false when SCHED_MAX_JOBS are registered, add all jobs before begin()
+    bool add(const char *name, JobFn fn, void *ctx, uint16_t periodMs, uint16_t budgetUs);
+
+    // Runs the due jobs, returns the ms until the next release.
+    uint32_t runDue(uint32_t nowMs);
+
+    // Runs the jobs in a task of their own against millis().
+    bool begin(const char *name, BaseType_t core, UBaseType_t priority, uint32_t stackSize = 4096);
+
+    uint8_t  jobCount() const { return count; }
+    const JobStats &stats(uint8_t job) const { return jobs[job].stats; }
+    uint32_t idleMs() const { return idleTotal; }     // time slept by the task
+
+    // Bucket i counts runs below histogramBound(i) us, the last bucket
+    // everything above.
+    static uint16_t histogramBound(uint8_t bucket);
+
+private:
+    struct Job {
+        JobFn    fn;
+        void    *ctx;
+        uint32_t release;
+        bool     started;
+        JobStats stats;
+    };
+
+    static void taskEntry(void *arg);
+    void runJob(Job &job, uint32_t nowMs);
+
+    Job      jobs[SCHED_MAX_JOBS];
+    uint8_t  count = 0;
+    TaskHandle_t task = NULL;
+    volatile uint32_t idleTotal = 0;
+};
+
+#endif /* JOB_SCHED_H_ */
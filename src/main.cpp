@@ -13,10 +13,30 @@
 #include <ArduinoJson.h>
 #include <Adafruit_NeoPixel.h>
 #include <Wire.h>
+#include <soc/gpio_reg.h>
 #include "secrets.h"
 #include "rotswitch.h"
 #include "swr_led.h"
 #include "tca9539.h"
+#include "ws_proto.h"
+#include "ws_cmd.h"
+#include "relay_seq.h"
+#include "i2c_worker.h"
+#include "ioex_input.h"
+#include "ioex_bus.h"
+#include "adc_sampler.h"
+#include "swr_calc.h"
+#include "swr_interlock.h"
+#include "swr_history.h"
+#include "swr_capture.h"
+#include "antenna_scan.h"
+#include "state_bcast.h"
+#include "ws_outbox.h"
+#include "spsc_queue.h"
+#include "seqlock.h"
+#include "periodic_task.h"
+#include "job_sched.h"
+#include "input_bank.h"
 
 
 // ----------------------------------------------------------------------------
@@ -30,7 +50,61 @@
 #define HTTP_PORT 80
 #define SCL_PIN   47
 #define SDA_PIN   21
+//#define SCL1_PIN  17      // second I2C bus for additional relay boards
+//#define SDA1_PIN  18
 #define IO_EXP_1_ADDR 0x74
+//#define IO_EXP_1_INT  14     // TCA9539 INT line, define when it is wired
+#ifdef IO_EXP_1_INT
+#define IO_EXP_1_INPUTS 0xff00 // PORT2 pins are inputs, the relays are on PORT1
+#define PTT_SENSE_PIN   8      // transceiver PTT on P2.0 of the expander, low while keyed
+#else
+#define IO_EXP_1_INPUTS 0x0000
+#endif
+#define SWR_PIN   16          // forward detector
+#define SWR_REF_PIN 5         // reflected detector
+//#define AMP_INHIBIT_PIN 2   // amplifier inhibit output (active high), define when it is wired
+//#define SWR_COMP_PIN  1     // external high-SWR comparator (active low), define when it is wired
+
+// The optional pins must not take a GPIO that is already in use
+#define PIN_IN_USE(p) ((p) == LED_PIN || (p) == BTN_PIN || (p) == NEO_PIN || (p) == SCL_PIN \
+    || (p) == SDA_PIN || (p) == SWR_PIN || (p) == SWR_REF_PIN \
+    || (p) == ROTSW_01 || (p) == ROTSW_02 || (p) == ROTSW_03 || (p) == ROTSW_04 \
+    || (p) == ROTSW_05 || (p) == ROTSW_06 || (p) == ROTSW_07 || (p) == ROTSW_08 \
+    || (p) == SWRLED_01 || (p) == SWRLED_04 || (p) == SWRLED_05 || (p) == SWRLED_06 \
+    || (p) == SWRLED_07 || (p) == SWRLED_08 || (p) == SWRLED_09 || (p) == SWRLED_10)
+
+#if defined(SDA1_PIN) && (PIN_IN_USE(SDA1_PIN) || PIN_IN_USE(SCL1_PIN) || SDA1_PIN == SCL1_PIN)
+#error "SDA1_PIN/SCL1_PIN collide with another pin"
+#endif
+#if defined(IO_EXP_1_INT) && (PIN_IN_USE(IO_EXP_1_INT) \
+    || (defined(SDA1_PIN) && (IO_EXP_1_INT == SDA1_PIN || IO_EXP_1_INT == SCL1_PIN)))
+#error "IO_EXP_1_INT collides with another pin"
+#endif
+#ifdef AMP_INHIBIT_PIN
+#if PIN_IN_USE(AMP_INHIBIT_PIN) || (defined(SDA1_PIN) && (AMP_INHIBIT_PIN == SDA1_PIN || AMP_INHIBIT_PIN == SCL1_PIN)) \
+    || (defined(IO_EXP_1_INT) && AMP_INHIBIT_PIN == IO_EXP_1_INT)
+#error "AMP_INHIBIT_PIN collides with another pin"
+#endif
+#if AMP_INHIBIT_PIN >= 32
+#error "AMP_INHIBIT_PIN is driven through GPIO_OUT_W1TS_REG, it has to be below 32"
+#endif
+#endif
+#if defined(SWR_COMP_PIN) && (PIN_IN_USE(SWR_COMP_PIN) \
+    || (defined(SDA1_PIN) && (SWR_COMP_PIN == SDA1_PIN || SWR_COMP_PIN == SCL1_PIN)) \
+    || (defined(IO_EXP_1_INT) && SWR_COMP_PIN == IO_EXP_1_INT) \
+    || (defined(AMP_INHIBIT_PIN) && SWR_COMP_PIN == AMP_INHIBIT_PIN))
+#error "SWR_COMP_PIN collides with another pin"
+#endif
+
+// Inputs, interlocks and relays run in the control task on one core, the
+// web server and the UI in the network task on the other one, next to WiFi
+// and async_tcp (see CONFIG_ASYNC_TCP_RUNNING_CORE in platformio.ini). Both
+// run their work as scheduler jobs, see setup().
+#define CONTROL_PERIOD_MS   5
+#define CONTROL_CORE        1
+#define CONTROL_PRIORITY    10
+#define NET_CORE            0
+#define NET_PRIORITY        1
 
 // ----------------------------------------------------------------------------
 // Definition of global constants
@@ -40,11 +114,22 @@
 uint8_t wanted_dir = 0;
 uint8_t actual_dir = 0;
 uint8_t lastRotaryDir = 0;
+SwrResult swr_meas = {};
+uint8_t stateFlags = 0;
+uint32_t lastReadingCount = 0;
+uint32_t stateVersion = 0;      // bumped by the control task on every state change
 
-unsigned long lastNotifyClientMillis;
+// network task
+uint32_t lastCaptureId = 0;
+uint32_t seenStateVersion = 0;
+uint8_t  shownFlags = 0;
+uint8_t  shownDir = 0;
+bool     stripLedOn = false;
+std::atomic<uint32_t> notifySeq(0);   // also read by async_tcp for a new client's first frame
+uint16_t notifiedSwr = 0;       // SWR carried by the last state frame
+uint32_t seenScanReports = 0;
 
-// Button debouncing
-const uint8_t DEBOUNCE_DELAY = 10; // in milliseconds
+unsigned long lastStatusMillis;
 
 
 // WiFi credentials
@@ -67,65 +152,229 @@ struct Led {
 };
 
 // ----------------------------------------------------------------------------
-// Definition of the Button component
+// Digital inputs
 // ----------------------------------------------------------------------------
+// The rotary switch contacts and the button are sampled together into one
+// InputBank mask every control cycle and debounced in parallel.
 
-struct Button {
-    // state variables
-    uint8_t  pin;
-    bool     lastReading;
-    uint32_t lastDebounceTime;
-    uint16_t state;
-
-    // methods determining the logical state of the button
-    bool pressed()                { return state == 1; }
-    bool released()               { return state == 0xffff; }
-    bool held(uint16_t count = 0) { return state > 1 + count && state < 0xffff; }
-
-    // method for reading the physical state of the button
-    void read() {
-        // reads the voltage on the pin connected to the button
-        bool reading = digitalRead(pin);
-
-        // if the logic level has changed since the last reading,
-        // we reset the timer which counts down the necessary time
-        // beyond which we can consider that the bouncing effect
-        // has passed.
-        if (reading != lastReading) {
-            lastDebounceTime = millis();
-        }
+#define IN_ROTARY_MASK      0x00ffUL    // contacts 1..8 on bits 0..7
+#define IN_BUTTON           (1UL << 8)
+#define ROTSW_SETTLE_TICKS  4           // quiet ticks before a new position counts
+#define BUTTON_LONG_TICKS   200         // 1 s at the control period
+#define BUTTON_REPEAT_TICKS 100
 
-        // from the moment we're out of the bouncing phase
-        // the actual status of the button can be determined
-        if (millis() - lastDebounceTime > DEBOUNCE_DELAY) {
-            // don't forget that the read pin is pulled-up
-            bool pressed = reading == LOW;
-            if (pressed) {
-                     if (state  < 0xfffe) state++;
-                else if (state == 0xfffe) state = 2;
-            } else if (state) {
-                state = state == 0xffff ? 0 : 0xffff;
-            }
-        }
-
-        // finally, each new reading is saved
-        lastReading = reading;
-    }
-};
+uint32_t sampleInputs() {
+    uint32_t lo = REG_READ(GPIO_IN_REG);
+    uint32_t hi = REG_READ(GPIO_IN1_REG);
+    uint32_t in = rotarySwitchContacts(lo, hi);
+    // the button pulls the pin low
+    uint32_t btn = BTN_PIN < 32 ? lo >> BTN_PIN : hi >> (BTN_PIN - 32);
+    if (!(btn & 1)) in |= IN_BUTTON;
+    return in;
+}
 
 // ----------------------------------------------------------------------------
 // Definition of global variables
 // ----------------------------------------------------------------------------
 
 Led    led         = { LED_PIN, false };
-Button button      = { BTN_PIN, HIGH, 0, 0 };
+InputBank inputs;
+uint32_t  rotaryChangedAt = 0;  // inputs tick of the last contact change
+bool      rotaryPending = false;
+uint32_t  buttonPresses = 0;
+uint32_t  buttonLongPresses = 0;
 
-TCA9539 ioex1;
+I2CWorker i2c;          // owns Wire after setup()
+#ifdef SDA1_PIN
+I2CWorker i2c1;         // owns Wire1 after setup()
+#endif
+IoExBus   relayBus;     // direction relays are logical pins 0..7 of device 0
+#ifdef IO_EXP_1_INT
+IoExInput ioex1Inputs;
+bool      pttKeyed = true;      // until the expander reported the PTT line
+#endif
+RelaySequencer relays;
+AdcSampler     swrAdc;
+PowerCurve     fwdCal;
+PowerCurve     refCal;
+SwrInterlock   swrGuard;
+SwrHistory     swrHistory;
+SwrCapture     swrCapture;
+AntennaScan    scan;
+StateBroadcaster stateBcast;    // all state frames go out through it, network task only
+PeriodicTask   controlTask;
+JobScheduler   controlJobs;     // stepped once per control cycle
+JobScheduler   netJobs;         // runs the network task
+uint32_t       controlClock = 0;
 
 Adafruit_NeoPixel strip(NEO_COUNT, NEO_PIN, NEO_GRB + NEO_KHZ800);
 
 AsyncWebServer server(HTTP_PORT);
 AsyncWebSocket ws("/ws");
+AsyncWebSocket wsBin("/ws/bin");
+
+// Network callbacks run on the async_tcp task. They never touch the control
+// state, commands are queued for the control task instead, and the control
+// task publishes the state back as a snapshot. The async_tcp task is the
+// only producer.
+struct LoopCommand {
+    void          (*handler)(uint8_t arg);
+    uint8_t         arg;
+    const char     *ack;        // action to acknowledge, NULL for none
+    AsyncWebSocket *server;
+    uint32_t        client;
+};
+
+struct StateSnapshot {
+    uint32_t  version;
+    bool      ledOn;
+    uint8_t   actualDir;
+    uint8_t   wantedDir;
+    uint8_t   flags;
+    SwrResult swr;
+};
+
+// The control task hands the network task everything it has to send the
+// same way: command acks through a queue, finished sweeps as a report.
+struct CommandAck {
+    AsyncWebSocket *server;
+    uint32_t        client;
+    const char     *action;
+};
+
+struct ScanReport {
+    uint8_t   status;
+    uint8_t   count;
+    uint32_t  durationMs;
+    ScanEntry entries[SCAN_DIRECTIONS];
+};
+
+#define LOOP_QUEUE_LEN  16
+
+SpscQueue<LoopCommand, LOOP_QUEUE_LEN> loopCommands;
+SpscQueue<CommandAck, LOOP_QUEUE_LEN>  commandAcks;
+Seqlock<StateSnapshot>     stateSnapshot;
+Seqlock<ScanReport>        scanReport;      // written once per finished sweep
+uint32_t commandsRejected = 0;
+
+// ----------------------------------------------------------------------------
+// Relay driver on the TCA9539 expanders
+// ----------------------------------------------------------------------------
+// The expanders are only accessed directly during setup(), afterwards the I2C
+// workers own the buses and relay writes are queued so the control task
+// never waits.
+
+// A relay write can wait behind one queued transaction, both with all their
+// retries, before its read-back confirms it
+#define RELAY_CONFIRM_TIMEOUT_MS (2 * I2C_WORST_CASE_MS)
+
+bool writeRelays(uint16_t mask) {
+    relayBus.setWord(0, mask);
+    return relayBus.commit();
+}
+
+int8_t confirmRelays(uint16_t mask) {
+    return mask == relayBus.word(0) ? relayBus.commitResult(0) : -1;
+}
+
+// ----------------------------------------------------------------------------
+// SWR sampling
+// ----------------------------------------------------------------------------
+
+void readSWRPins(void *, uint16_t *values) {
+    values[ADC_CH_FWD] = analogRead(SWR_PIN);
+    values[ADC_CH_REF] = analogRead(SWR_REF_PIN);
+}
+
+bool relayInterlockOk() {
+#ifdef IO_EXP_1_INT
+    if (pttKeyed) return false;
+#endif
+    return !swrGuard.rfPresent() && !swrGuard.tripped();
+}
+
+#ifdef IO_EXP_1_INT
+// Runs in the control task when ioex1Inputs resolves an input change
+void onExpanderInput(uint8_t pin, bool level, void *) {
+    if (pin == PTT_SENSE_PIN) pttKeyed = !level;
+}
+#endif
+
+// Runs in the sampler task (or the comparator interrupt), keep it short
+void IRAM_ATTR onSwrTrip(bool tripped, void *) {
+#ifdef AMP_INHIBIT_PIN
+    if (tripped) {
+        REG_WRITE(GPIO_OUT_W1TS_REG, 1UL << AMP_INHIBIT_PIN);
+    } else {
+        REG_WRITE(GPIO_OUT_W1TC_REG, 1UL << AMP_INHIBIT_PIN);
+    }
+#endif
+}
+
+void onSwrSample(const AdcSample &sample, uint32_t sampledAt, void *) {
+    swrGuard.process(sample.ch, sampledAt);
+    swrCapture.process(sample);
+}
+
+#ifdef SWR_COMP_PIN
+void IRAM_ATTR onSwrComparator() {
+    swrGuard.trip(SWR_TRIP_COMPARATOR, micros());
+}
+#endif
+
+uint8_t readStateFlags() {
+    return (swrGuard.rfPresent() ? WS_FLAG_RF : 0) | (swrGuard.tripped() ? WS_FLAG_SWR_TRIP : 0)
+         | (scan.running() ? WS_FLAG_SCAN : 0)
+         | (relays.state() == RelaySequencer::State::FAULT ? WS_FLAG_RELAY_FAULT : 0);
+}
+
+// Reads one curve, [[adc, mW], ...], from the calibration file
+bool loadCalCurve(PowerCurve &curve, JsonArrayConst points) {
+    CalPoint cal[SWR_CAL_MAX_POINTS];
+    uint8_t n = 0;
+    for (JsonArrayConst p : points) {
+        if (n >= SWR_CAL_MAX_POINTS) return false;
+        cal[n].adc = p[0].as<uint16_t>();
+        cal[n].mw  = p[1].as<uint32_t>();
+        n++;
+    }
+    return curve.load(cal, n);
+}
+
+// The built-in detector curves can be replaced by measured ones in
+// /cal.json: {"fwd": [[adc, mW], ...], "ref": [[adc, mW], ...]}
+void initSWRCalibration() {
+    fwdCal.load(SWR_FWD_CAL, SWR_FWD_CAL_POINTS);
+    refCal.load(SWR_REF_CAL, SWR_REF_CAL_POINTS);
+
+    File file = SPIFFS.open("/cal.json", "r");
+    if (!file) return;
+    JsonDocument json;
+    DeserializationError err = deserializeJson(json, file);
+    file.close();
+    if (err) {
+        Serial.printf("Cannot parse /cal.json: %s\n", err.c_str());
+        return;
+    }
+    if (!json["fwd"].isNull() && !loadCalCurve(fwdCal, json["fwd"].as<JsonArrayConst>())) Serial.println("Invalid forward calibration");
+    if (!json["ref"].isNull() && !loadCalCurve(refCal, json["ref"].as<JsonArrayConst>())) Serial.println("Invalid reflected calibration");
+}
+
+// Bar graph scale: SWR 1.0 .. 2.0 over the full raw range
+uint16_t swrDisplayValue(const SwrResult &m) {
+    if (m.swrQ8 <= SWR_Q8_MIN) return 0;
+    uint32_t v = (uint32_t)(m.swrQ8 - SWR_Q8_MIN) << 4;
+    return v > SWR_RAW_MAX ? SWR_RAW_MAX : v;
+}
+
+void printRelayHistogram() {
+    Serial.printf("Relay switch %lu ms (max %lu), histogram:",
+                  (unsigned long)relays.lastLatency(), (unsigned long)relays.maxLatency());
+    for (uint8_t i = 0; i < RELAY_HIST_BUCKETS; i++) {
+        Serial.printf(" <%u:%lu", RelaySequencer::histogramBound(i), (unsigned long)relays.histogram(i));
+    }
+    Serial.println();
+}
 
 // ----------------------------------------------------------------------------
 // SPIFFS initialization
@@ -154,21 +403,462 @@ void initWiFi() {
   Serial.printf(" %s\n", WiFi.localIP().toString().c_str());
 }
 
+// ----------------------------------------------------------------------------
+// WebSocket client queues
+// ----------------------------------------------------------------------------
+// Frames for the clients go into per-client outboxes (see ws_outbox.h) and
+// wsPump() hands them to the library only as fast as each TCP connection
+// takes them. The library's clients belong to the async_tcp task, so the
+// pump runs there: from the client's TCP ack and poll callbacks, and after
+// the connect and data events. A frame queued while nothing is in flight
+// goes out with the next poll, within half a second. Clients are added and
+// removed by the async_tcp task, a closed client's slot is cleaned up and
+// freed by the network task.
+
+#define WS_MAX_PEERS        8
+#define WS_FRAME_OVERHEAD   10      // largest server frame header
+
+#define WS_PEER_FREE        0
+#define WS_PEER_ACTIVE      1
+#define WS_PEER_CLOSED      2
+
+struct WsPeer {
+    std::atomic<uint8_t> state;
+    std::atomic<bool>    overflow;  // an ACK did not fit, close the client
+    AsyncWebSocket       *server;
+    AsyncWebSocketClient *client;   // only used in the async_tcp task
+    uint32_t             id;
+    WsOutbox             box;
+};
+
+WsPeer   wsPeers[WS_MAX_PEERS];
+uint32_t wsOverflowCloses = 0;
+
+void wsAddPeer(AsyncWebSocket *server, AsyncWebSocketClient *client) {
+    for (WsPeer &p : wsPeers) {
+        if (p.state.load(std::memory_order_acquire) != WS_PEER_FREE) continue;
+        p.server   = server;
+        p.client   = client;
+        p.id       = client->id();
+        p.overflow = false;
+        p.state.store(WS_PEER_ACTIVE, std::memory_order_release);
+        return;
+    }
+    client->close();
+}
+
+void wsRemovePeer(AsyncWebSocket *server, AsyncWebSocketClient *client) {
+    for (WsPeer &p : wsPeers) {
+        if (p.state.load(std::memory_order_acquire) == WS_PEER_ACTIVE && p.server == server && p.id == client->id()) {
+            p.state.store(WS_PEER_CLOSED, std::memory_order_release);
+        }
+    }
+}
+
+// Whether server has clients, from the peer table: the library's own
+// client list belongs to the async_tcp task
+bool wsHasPeers(const AsyncWebSocket &server) {
+    for (WsPeer &p : wsPeers) {
+        if (p.state.load(std::memory_order_acquire) == WS_PEER_ACTIVE && p.server == &server) return true;
+    }
+    return false;
+}
+
+// Queues frame for every client of server
+void wsQueueAll(AsyncWebSocket &server, WsFrameClass cls, WsFrame *frame) {
+    for (WsPeer &p : wsPeers) {
+        if (p.state.load(std::memory_order_acquire) != WS_PEER_ACTIVE || p.server != &server) continue;
+        if (!p.box.push(cls, frame)) p.overflow = true;
+    }
+}
+
+void wsBroadcast(AsyncWebSocket &server, WsFrameClass cls, const void *data, size_t len, bool binary) {
+    if (!wsHasPeers(server)) return;
+    WsFrame *frame = wsFrameAlloc(len, binary);
+    if (frame == NULL) return;
+    memcpy(frame->data, data, len);
+    wsQueueAll(server, cls, frame);
+    wsFrameRelease(frame);
+}
+
+// Queues frame for one client
+void wsQueueTo(AsyncWebSocket *server, uint32_t id, WsFrameClass cls, WsFrame *frame) {
+    for (WsPeer &p : wsPeers) {
+        if (p.state.load(std::memory_order_acquire) != WS_PEER_ACTIVE || p.server != server || p.id != id) continue;
+        if (!p.box.push(cls, frame)) p.overflow = true;
+    }
+}
+
+// Runs in the async_tcp task
+void wsPump(WsPeer &p) {
+    AsyncWebSocketClient *client = p.client;
+    if (client->status() != WS_CONNECTED) return;
+    if (p.overflow.exchange(false)) {
+        // it cannot even keep up with the acks
+        wsOverflowCloses++;
+        client->close();
+        return;
+    }
+
+    while (WsFrame *frame = p.box.peek()) {
+        AsyncClient *tcp = client->client();
+        bool fits = tcp && !client->queueIsFull() && tcp->space() >= frame->len + WS_FRAME_OVERHEAD;
+        if (fits) {
+            if (frame->binary) {
+                client->binary((const char *)frame->data, frame->len);
+            } else {
+                client->text((const char *)frame->data, frame->len);
+            }
+            p.box.pop(frame);
+        }
+        wsFrameRelease(frame);
+        if (!fits) break;
+    }
+}
+
+void wsPumpClient(AsyncWebSocketClient *client) {
+    for (WsPeer &p : wsPeers) {
+        if (p.state.load(std::memory_order_acquire) == WS_PEER_ACTIVE && p.client == client) wsPump(p);
+    }
+}
+
+// Replaces the library's TCP ack and poll handlers of a new client with ones
+// that call them and then pump the client's outbox. The library registers
+// its own _onAck()/_onPoll() the same way, they are public for this.
+void wsHookClient(AsyncWebSocketClient *client) {
+    AsyncClient *tcp = client->client();
+    if (tcp == NULL) return;
+    tcp->onAck([](void *arg, AsyncClient *, size_t len, uint32_t time) {
+        AsyncWebSocketClient *c = (AsyncWebSocketClient *)arg;
+        c->_onAck(len, time);
+        wsPumpClient(c);
+    }, client);
+    tcp->onPoll([](void *arg, AsyncClient *) {
+        AsyncWebSocketClient *c = (AsyncWebSocketClient *)arg;
+        c->_onPoll();
+        wsPumpClient(c);
+    }, client);
+}
+
+// Frees the slots of closed clients, in the network task
+void wsReapPeers() {
+    for (WsPeer &p : wsPeers) {
+        if (p.state.load(std::memory_order_acquire) != WS_PEER_CLOSED) continue;
+        p.box.clear();
+        p.state.store(WS_PEER_FREE, std::memory_order_release);
+    }
+}
+
+void printWsMetrics(AsyncResponseStream *response) {
+    response->printf("ws_overflow_closes_total %lu\n", (unsigned long)wsOverflowCloses);
+    response->printf("ws_commands_rejected_total %lu\n", (unsigned long)commandsRejected);
+    for (WsPeer &p : wsPeers) {
+        if (p.state.load(std::memory_order_acquire) != WS_PEER_ACTIVE) continue;
+        const char *path = p.server == &wsBin ? "/ws/bin" : "/ws";
+        const char *labels = "{path=\"%s\",client=\"%lu\"} %lu\n";
+        response->print("ws_client_queue_depth");     response->printf(labels, path, (unsigned long)p.id, (unsigned long)p.box.depth());
+        response->print("ws_client_queue_max_depth"); response->printf(labels, path, (unsigned long)p.id, (unsigned long)p.box.maxDepth());
+        response->print("ws_client_sent_total");      response->printf(labels, path, (unsigned long)p.id, (unsigned long)p.box.sent());
+        response->print("ws_client_dropped_total");   response->printf(labels, path, (unsigned long)p.id, (unsigned long)p.box.dropped());
+        response->print("ws_client_replaced_total");  response->printf(labels, path, (unsigned long)p.id, (unsigned long)p.box.replaced());
+    }
+}
+
 // ----------------------------------------------------------------------------
 // Web server initialization
 // ----------------------------------------------------------------------------
 
-String processor(const String &var) {
-    return String(var == "STATE" && led.on ? "on" : "off");
+// tools/build_assets.py stores the web assets gzipped, each with a
+// content-hash ETag, and lists them in /assets.txt. They are sent as they
+// are with Content-Encoding: gzip. index.html is revalidated on every load,
+// a 304 when it did not change, and refers to the other assets with their
+// hash in the URL, so those are cached for good. The page carries no state,
+// a new WebSocket client gets it as its first frame.
+
+#define ASSET_MAX       12
+#define ASSET_PATH_LEN  24
+#define ASSET_ETAG_LEN  20
+#define ASSET_TYPE_LEN  28
+
+struct Asset {
+    char path[ASSET_PATH_LEN];
+    char etag[ASSET_ETAG_LEN];      // quoted, as sent
+    char type[ASSET_TYPE_LEN];
+};
+
+Asset   assets[ASSET_MAX];
+uint8_t assetCount = 0;
+
+bool initAssets() {
+    File file = SPIFFS.open("/assets.txt", "r");
+    if (!file) return false;
+    while (file.available() && assetCount < ASSET_MAX) {
+        String line = file.readStringUntil('\n');
+        Asset &a = assets[assetCount];
+        if (sscanf(line.c_str(), "%23s %19s %27s", a.path, a.etag, a.type) == 3) assetCount++;
+    }
+    file.close();
+    return assetCount > 0;
+}
+
+const Asset *findAsset(const String &url) {
+    const char *path = url == "/" ? "/index.html" : url.c_str();
+    for (uint8_t i = 0; i < assetCount; i++) {
+        if (strcmp(assets[i].path, path) == 0) return &assets[i];
+    }
+    return NULL;
+}
+
+class AssetHandler : public AsyncWebHandler {
+public:
+    bool canHandle(AsyncWebServerRequest *request) override {
+        if (request->method() != HTTP_GET || findAsset(request->url()) == NULL) return false;
+        // the library drops every header no handler asked for
+        request->addInterestingHeader("If-None-Match");
+        return true;
+    }
+
+    void handleRequest(AsyncWebServerRequest *request) override {
+        const Asset *a = findAsset(request->url());
+        AsyncWebServerResponse *response;
+        if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == a->etag) {
+            response = request->beginResponse(304);
+        } else {
+            char path[ASSET_PATH_LEN + 4];
+            snprintf(path, sizeof(path), "%s.gz", a->path);
+            response = request->beginResponse(SPIFFS, path, a->type);
+            response->addHeader("Content-Encoding", "gzip");
+        }
+        response->addHeader("ETag", a->etag);
+        response->addHeader("Cache-Control", strcmp(a->type, "text/html") == 0
+                            ? "no-cache" : "public, max-age=31536000, immutable");
+        request->send(response);
+    }
+};
+
+AssetHandler assetHandler;
+
+void printI2CMetrics(AsyncResponseStream *response, I2CWorker &worker, uint8_t bus) {
+    response->printf("i2c_recoveries_total{bus=\"%u\"} %lu\n", bus, (unsigned long)worker.recoveries());
+    response->printf("i2c_queue_rejected_total{bus=\"%u\"} %lu\n", bus, (unsigned long)worker.rejected());
+    for (uint8_t i = 0; i < worker.deviceCount(); i++) {
+        const I2CDeviceStats &d = worker.deviceStats(i);
+        const char *labels = "{bus=\"%u\",addr=\"0x%02x\"} %lu\n";
+        response->print("i2c_transactions_total");    response->printf(labels, bus, d.addr, (unsigned long)d.transactions);
+        response->print("i2c_errors_total");          response->printf(labels, bus, d.addr, (unsigned long)d.errors);
+        response->print("i2c_retries_total");         response->printf(labels, bus, d.addr, (unsigned long)d.retries);
+        response->print("i2c_verify_failures_total"); response->printf(labels, bus, d.addr, (unsigned long)d.verifyFailures);
+        response->print("i2c_latency_us");            response->printf(labels, bus, d.addr, (unsigned long)d.lastLatencyUs);
+        response->print("i2c_latency_max_us");        response->printf(labels, bus, d.addr, (unsigned long)d.maxLatencyUs);
+    }
+}
+
+// Prometheus text format
+void printTaskMetrics(AsyncResponseStream *response, const PeriodicTask &task, const char *name) {
+    response->printf("task_period_ms{task=\"%s\"} %u\n", name, task.period());
+    response->printf("task_cycles_total{task=\"%s\"} %lu\n", name, (unsigned long)task.cycles());
+    response->printf("task_overruns_total{task=\"%s\"} %lu\n", name, (unsigned long)task.overruns());
+    response->printf("task_cycle_us{task=\"%s\"} %lu\n", name, (unsigned long)task.lastCycle());
+    response->printf("task_cycle_max_us{task=\"%s\"} %lu\n", name, (unsigned long)task.maxCycle());
+    response->printf("task_jitter_us{task=\"%s\"} %lu\n", name, (unsigned long)task.lastJitter());
+    response->printf("task_jitter_max_us{task=\"%s\"} %lu\n", name, (unsigned long)task.maxJitter());
 }
 
-void onRootRequest(AsyncWebServerRequest *request) {
-  request->send(SPIFFS, "/index.html", "text/html", false, processor);
+void printJobMetrics(AsyncResponseStream *response, const JobScheduler &sched, const char *task) {
+    for (uint8_t i = 0; i < sched.jobCount(); i++) {
+        const JobStats &j = sched.stats(i);
+        const char *labels = "{task=\"%s\",job=\"%s\"} %lu\n";
+        response->print("sched_job_period_ms");    response->printf(labels, task, j.name, (unsigned long)j.periodMs);
+        response->print("sched_job_budget_us");    response->printf(labels, task, j.name, (unsigned long)j.budgetUs);
+        response->print("sched_job_runs_total");   response->printf(labels, task, j.name, (unsigned long)j.runs);
+        response->print("sched_job_overruns_total"); response->printf(labels, task, j.name, (unsigned long)j.overruns);
+        response->print("sched_job_missed_total"); response->printf(labels, task, j.name, (unsigned long)j.missed);
+        response->print("sched_job_exec_us");      response->printf(labels, task, j.name, (unsigned long)j.lastUs);
+        response->print("sched_job_exec_max_us");  response->printf(labels, task, j.name, (unsigned long)j.maxUs);
+        response->print("sched_job_late_max_ms");  response->printf(labels, task, j.name, (unsigned long)j.maxLateMs);
+        // cumulative, like a Prometheus histogram
+        uint32_t total = 0;
+        for (uint8_t b = 0; b < SCHED_HIST_BUCKETS; b++) {
+            total += j.hist[b];
+            if (b < SCHED_HIST_BUCKETS - 1) {
+                response->printf("sched_job_exec_us_bucket{task=\"%s\",job=\"%s\",le=\"%u\"} %lu\n",
+                                 task, j.name, JobScheduler::histogramBound(b), (unsigned long)total);
+            } else {
+                response->printf("sched_job_exec_us_bucket{task=\"%s\",job=\"%s\",le=\"+Inf\"} %lu\n",
+                                 task, j.name, (unsigned long)total);
+            }
+        }
+    }
+}
+
+void onMetricsRequest(AsyncWebServerRequest *request) {
+    AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4");
+    printI2CMetrics(response, i2c, 0);
+#ifdef SDA1_PIN
+    printI2CMetrics(response, i2c1, 1);
+#endif
+    response->printf("swr_trips_total %lu\n", (unsigned long)swrGuard.trips());
+    response->printf("swr_trip_latency_us %lu\n", (unsigned long)swrGuard.lastLatency());
+    response->printf("swr_trip_latency_max_us %lu\n", (unsigned long)swrGuard.maxLatency());
+    printWsMetrics(response);
+    response->printf("ws_state_frames_total %lu\n", (unsigned long)stateBcast.frames());
+    response->printf("ws_state_coalesced_total %lu\n", (unsigned long)stateBcast.coalesced());
+    response->printf("ws_heartbeats_skipped_total %lu\n", (unsigned long)stateBcast.skippedBeats());
+    response->printf("ws_state_staleness_ms %lu\n", (unsigned long)stateBcast.lastStaleness());
+    response->printf("ws_state_staleness_max_ms %lu\n", (unsigned long)stateBcast.maxStaleness());
+    response->printf("button_presses_total %lu\n", (unsigned long)buttonPresses);
+    response->printf("button_long_presses_total %lu\n", (unsigned long)buttonLongPresses);
+    response->printf("rotary_faults_total %lu\n", (unsigned long)rotarySwitchFaults());
+    response->printf("scan_sweeps_total %lu\n", (unsigned long)scan.sweeps());
+    response->printf("scan_duration_ms %lu\n", (unsigned long)scan.lastDuration());
+    response->printf("scan_duration_max_ms %lu\n", (unsigned long)scan.maxDuration());
+    printTaskMetrics(response, controlTask, "control");
+    printJobMetrics(response, controlJobs, "control");
+    printJobMetrics(response, netJobs, "net");
+    response->printf("sched_idle_ms_total{task=\"net\"} %lu\n", (unsigned long)netJobs.idleMs());
+    request->send(response);
+}
+
+// /history?tier=raw|1s|1m|1h[&from=ms][&to=ms][&last=ms][&dir=1..8][&format=bin|csv]
+// Times are millis() on the device, X-Uptime-Ms tells the client the current
+// one, last=ms selects the most recent period instead of from. The records
+// are streamed straight from the history rings.
+struct HistStream {
+    HistCursor cursor;
+    uint8_t    spill[HIST_CSV_LINE_MAX];    // one record for a short buffer
+    uint8_t    spillPos, spillLen;
+};
+
+void onHistoryRequest(AsyncWebServerRequest *request) {
+    uint32_t now = millis();
+    int8_t tier = HIST_1S;
+    if (request->hasParam("tier")) tier = SwrHistory::tierByName(request->getParam("tier")->value().c_str());
+    if (tier < 0) {
+        request->send(400, "text/plain", "unknown tier");
+        return;
+    }
+    uint32_t from = request->hasParam("from") ? strtoul(request->getParam("from")->value().c_str(), NULL, 10) : now - 0x7fffffffUL;
+    if (request->hasParam("last")) from = now - strtoul(request->getParam("last")->value().c_str(), NULL, 10);
+    uint32_t to   = request->hasParam("to")   ? strtoul(request->getParam("to")->value().c_str(), NULL, 10)   : now;
+    uint8_t  dir  = request->hasParam("dir")  ? request->getParam("dir")->value().toInt() : 0;
+    bool     csv  = request->hasParam("format") && request->getParam("format")->value() == "csv";
+
+    HistStream stream = {};
+    stream.cursor = swrHistory.query(tier, from, to, dir, csv);
+    AsyncWebServerResponse *response = request->beginChunkedResponse(
+        csv ? "text/csv" : "application/octet-stream",
+        [stream](uint8_t *buffer, size_t maxLen, size_t) mutable -> size_t {
+            // exportChunk() only writes whole records, so when the server
+            // offers less room than one the record goes out in pieces
+            if (stream.spillPos == stream.spillLen && maxLen < HIST_CSV_LINE_MAX) {
+                stream.spillPos = 0;
+                stream.spillLen = swrHistory.exportChunk(stream.cursor, stream.spill, sizeof(stream.spill));
+            }
+            if (stream.spillPos < stream.spillLen) {
+                size_t len = stream.spillLen - stream.spillPos;
+                if (len > maxLen) len = maxLen;
+                memcpy(buffer, stream.spill + stream.spillPos, len);
+                stream.spillPos += len;
+                return len;
+            }
+            // nothing left once a buffer of a whole record stays empty
+            return swrHistory.exportChunk(stream.cursor, buffer, maxLen);
+        });
+    response->addHeader("X-Uptime-Ms", String(now));
+    request->send(response);
+}
+
+// /capture[?id=N][&format=bin|csv], the newest capture by default. The
+// binary format is the WS_FRAME_CAPTURE frame.
+void onCaptureRequest(AsyncWebServerRequest *request) {
+    uint32_t id = request->hasParam("id") ? strtoul(request->getParam("id")->value().c_str(), NULL, 10) : swrCapture.latest();
+    size_t size = SwrCapture::frameLength(CAPTURE_MAX_SAMPLES);
+    uint8_t *frame = (uint8_t *)malloc(size);
+    size_t len = frame ? swrCapture.encode(id, frame, size) : 0;
+    if (len == 0) {
+        free(frame);
+        request->send(404, "text/plain", "no such capture");
+        return;
+    }
+
+    AsyncResponseStream *response;
+    if (request->hasParam("format") && request->getParam("format")->value() == "csv") {
+        response = request->beginResponseStream("text/csv");
+        uint16_t pre  = frame[16] | (frame[17] << 8);
+        uint16_t n    = pre + (frame[18] | (frame[19] << 8));
+        uint32_t rate = frame[20] | (frame[21] << 8) | ((uint32_t)frame[22] << 16) | ((uint32_t)frame[23] << 24);
+        response->printf("# capture %lu, dir %u\nt_us,fwd,ref\n", (unsigned long)id, frame[2]);
+        const uint8_t *p = frame + WS_CAPTURE_HEADER_LEN;
+        for (uint16_t i = 0; i < n; i++, p += ADC_CHANNELS * 2) {
+            response->printf("%ld,%u,%u\n", (long)((int32_t)(i - pre) * 1000000L / (int32_t)rate),
+                             p[0] | (p[1] << 8), p[2] | (p[3] << 8));
+        }
+    } else {
+        response = request->beginResponseStream("application/octet-stream");
+        response->write(frame, len);
+    }
+    free(frame);
+    request->send(response);
+}
+
+// /capture/config[?mode=off|single|auto][&channel=fwd|ref][&slope=rise|fall]
+// [&level=counts][&pre=n][&post=n], answers with the config in effect
+void onCaptureConfigRequest(AsyncWebServerRequest *request) {
+    CaptureConfig c = swrCapture.config();
+    if (request->hasParam("mode")) {
+        const String &m = request->getParam("mode")->value();
+        c.mode = m == "auto" ? CAPTURE_AUTO : m == "single" ? CAPTURE_SINGLE : CAPTURE_OFF;
+    }
+    if (request->hasParam("channel")) c.channel = request->getParam("channel")->value() == "fwd" ? ADC_CH_FWD : ADC_CH_REF;
+    if (request->hasParam("slope"))   c.slope   = request->getParam("slope")->value() == "fall" ? CAPTURE_FALLING : CAPTURE_RISING;
+    if (request->hasParam("level"))   c.level   = request->getParam("level")->value().toInt();
+    if (request->hasParam("pre"))     c.pre     = request->getParam("pre")->value().toInt();
+    if (request->hasParam("post"))    c.post    = request->getParam("post")->value().toInt();
+    if (request->params() && !swrCapture.configure(c)) {
+        request->send(400, "text/plain", "invalid capture config");
+        return;
+    }
+
+    JsonDocument json;
+    static const char *const MODES[] = { "off", "single", "auto" };
+    json["mode"]    = MODES[c.mode];
+    json["channel"] = c.channel == ADC_CH_FWD ? "fwd" : "ref";
+    json["slope"]   = c.slope == CAPTURE_FALLING ? "fall" : "rise";
+    json["level"]   = c.level;
+    json["pre"]     = c.pre;
+    json["post"]    = c.post;
+    json["latest"]  = swrCapture.latest();
+    String body;
+    serializeJson(json, body);
+    request->send(200, "application/json", body);
+}
+
+// New captures go to the binary clients as they are, the JSON clients only
+// get the id to fetch from /capture
+void notifyCapture(uint32_t id, uint8_t dir) {
+    size_t size = swrCapture.length(id);
+    WsFrame *frame = wsHasPeers(wsBin) && size ? wsFrameAlloc(size, true) : NULL;
+    if (frame) {
+        if (swrCapture.encode(id, frame->data, size)) wsQueueAll(wsBin, WsFrameClass::TELEMETRY, frame);
+        wsFrameRelease(frame);
+    }
+    char text[40];
+    size_t len = snprintf(text, sizeof(text), "{\"capture\":%lu,\"dir\":%u}", (unsigned long)id, dir);
+    wsBroadcast(ws, WsFrameClass::TELEMETRY, text, len, false);
 }
 
 void initWebServer() {
-    server.on("/", onRootRequest);
-    server.serveStatic("/", SPIFFS, "/");
+    server.on("/metrics", HTTP_GET, onMetricsRequest);
+    server.on("/history", HTTP_GET, onHistoryRequest);
+    server.on("/capture/config", HTTP_GET, onCaptureConfigRequest);
+    server.on("/capture", HTTP_GET, onCaptureRequest);
+    if (initAssets()) {
+        server.addHandler(&assetHandler);
+    } else {
+        // data/ uploaded without tools/build_assets.py
+        Serial.println("No /assets.txt, serving the files as they are");
+        server.serveStatic("/", SPIFFS, "/").setDefaultFile("index.html");
+    }
     server.begin();
 }
 
@@ -176,64 +866,208 @@ void initWebServer() {
 // WebSocket initialization
 // ----------------------------------------------------------------------------
 
-void notifyClients() {
+// Called by the control task whenever the clients have to see a change
+void stateChanged() {
+    stateVersion++;
+}
+
+// Publishes the control state for the network task, once per control cycle
+void publishState() {
+    StateSnapshot st = { stateVersion, led.on, actual_dir, wanted_dir, stateFlags, swr_meas };
+    stateSnapshot.write(st);
+}
+
+// State frame for the clients of server: JSON for /ws, the fixed binary
+// layout for /ws/bin
+WsFrame *encodeState(AsyncWebSocket &server, const StateSnapshot &st, uint32_t seq) {
+    if (&server == &wsBin) {
+        StateFrame frame = {
+            (uint8_t)(st.ledOn ? 1 : 0),
+            st.actualDir,
+            st.wantedDir,
+            st.flags,
+            st.swr.swrQ8,
+            seq,
+            millis()
+        };
+        WsFrame *out = wsFrameAlloc(WS_STATE_FRAME_LEN, true);
+        if (out) encodeStateFrame(frame, out->data, WS_STATE_FRAME_LEN);
+        return out;
+    }
+
     JsonDocument json;
-    json["status"] = led.on ? "on" : "off";
-    json["dir"] = actual_dir;
+    json["status"] = st.ledOn ? "on" : "off";
+    json["dir"] = st.actualDir;
+    json["rf"] = (st.flags & WS_FLAG_RF) != 0;
+    json["trip"] = (st.flags & WS_FLAG_SWR_TRIP) != 0;
+    json["scan"] = (st.flags & WS_FLAG_SCAN) != 0;
+    json["fault"] = (st.flags & WS_FLAG_RELAY_FAULT) != 0;
 
     char buffer[300];
     size_t len = serializeJson(json, buffer);
-    ws.textAll(buffer, len);
+    WsFrame *out = wsFrameAlloc(len, false);
+    if (out) memcpy(out->data, buffer, len);
+    return out;
 }
 
-void handleWebSocketMessage(void *arg, uint8_t *data, size_t len) {
-    AwsFrameInfo *info = (AwsFrameInfo*)arg;
-    if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
+// Sends the state frame, only called when stateBcast says so. Everything
+// else marks the state dirty.
+void notifyClients() {
+    StateSnapshot st;
+    stateSnapshot.read(st);
+    uint32_t seq = notifySeq.fetch_add(1, std::memory_order_relaxed) + 1;
+    notifiedSwr = st.swr.swrQ8;
+
+    AsyncWebSocket *servers[] = { &ws, &wsBin };
+    for (AsyncWebSocket *server : servers) {
+        if (!wsHasPeers(*server)) continue;
+        WsFrame *frame = encodeState(*server, st, seq);
+        if (frame == NULL) continue;
+        wsQueueAll(*server, WsFrameClass::STATE, frame);
+        wsFrameRelease(frame);
+    }
+}
 
+// The page carries no state, a new client gets it as its first frame. Runs
+// on the async_tcp task, it repeats the sequence number of the last frame.
+void sendInitialState(AsyncWebSocket *server, uint32_t client) {
+    StateSnapshot st;
+    stateSnapshot.read(st);
+    WsFrame *frame = encodeState(*server, st, notifySeq.load(std::memory_order_relaxed));
+    if (frame == NULL) return;
+    wsQueueTo(server, client, WsFrameClass::STATE, frame);
+    wsFrameRelease(frame);
+}
+
+// Ranked scan results, sent once a sweep ends
+void notifyScan(const ScanReport &r) {
+    if (wsHasPeers(wsBin)) {
+        uint8_t buffer[WS_SCAN_HEADER_LEN + SCAN_DIRECTIONS * WS_SCAN_ENTRY_LEN];
+        size_t len = encodeScanFrame(r.entries, r.count, r.status, r.durationMs, buffer, sizeof(buffer));
+        wsBroadcast(wsBin, WsFrameClass::TELEMETRY, buffer, len, true);
+    }
+    if (wsHasPeers(ws)) {
         JsonDocument json;
-        DeserializationError err = deserializeJson(json, data);
-        if (err) {
-            Serial.print(F("deserializeJson() failed with code "));
-            Serial.println(err.c_str());
-            return;
+        JsonObject result = json["scan"].to<JsonObject>();
+        result["status"] = r.status;
+        result["ms"] = r.durationMs;
+        JsonArray ranked = result["ranked"].to<JsonArray>();
+        for (uint8_t i = 0; i < r.count; i++) {
+            JsonObject e = ranked.add<JsonObject>();
+            e["dir"] = r.entries[i].dir;
+            e["n"]   = r.entries[i].readings;
+            e["swr"] = r.entries[i].swrAvg / 256.0;
+            e["min"] = r.entries[i].swrMin / 256.0;
+            e["max"] = r.entries[i].swrMax / 256.0;
         }
+        String text;
+        serializeJson(json, text);
+        wsBroadcast(ws, WsFrameClass::TELEMETRY, text.c_str(), text.length(), false);
+    }
+}
 
-        const char *action = json["action"];
-        if (strcmp(action, "toggle") == 0) {
-            led.on = !led.on;
-            if (led.on) {
-                strip.setPixelColor(0, 100, 0, 0);
-            } else {
-                strip.setPixelColor(0, 0, 0, 0);
-            }   
-            notifyClients();
-        }
-        if (strcmp(action, "NN") == 0) {
-            wanted_dir = 1;
-        }
-        if (strcmp(action, "NE") == 0) {
-            wanted_dir = 2;
-        }
-        if (strcmp(action, "E") == 0) {
-            wanted_dir = 3;
-        }
-        if (strcmp(action, "SE") == 0) {
-            wanted_dir = 4;
-        }
-        if (strcmp(action, "S") == 0) {
-            wanted_dir = 5;
+// Hands the results of the sweep that just ended to the network task
+void publishScan() {
+    ScanReport r = {};
+    r.status     = scan.status();
+    r.count      = scan.resultCount();
+    r.durationMs = scan.lastDuration();
+    for (uint8_t i = 0; i < r.count; i++) r.entries[i] = scan.result(i);
+    scanReport.write(r);
+}
+
+void onToggleCommand(uint8_t) {
+    led.on = !led.on;
+    stateChanged();
+}
+
+void onDirCommand(uint8_t dir) {
+    scan.abort(SCAN_ABORT_USER, dir, millis());
+    wanted_dir = dir;
+    // selecting the same direction again retries a relay fault
+    relays.retry(millis());
+}
+
+// starts a sweep, or stops the running one
+void onScanCommand(uint8_t) {
+    if (scan.running()) {
+        scan.abort(SCAN_ABORT_USER, scan.returnDirection(), millis());
+    } else {
+        scan.start(actual_dir, RELAY_SETTLE_MS, millis());
+    }
+}
+
+void onClearCommand(uint8_t) {
+    if (!swrGuard.clear()) Serial.println("SWR interlock not cleared, RF present");
+    relays.retry(millis());
+}
+
+// Handlers of the WS_COMMANDS actions, indexed by WsAction
+void (*const WS_HANDLERS[])(uint8_t) = {
+    onDirCommand,       // DIRECTION
+    onClearCommand,     // CLEAR
+    onScanCommand,      // SCAN
+    onToggleCommand,    // TOGGLE
+};
+static_assert(sizeof(WS_HANDLERS) / sizeof(WS_HANDLERS[0]) == (uint8_t)WsAction::TOGGLE + 1,
+              "one handler per WsAction");
+
+// Every command is acknowledged to the client that sent it
+void sendAck(AsyncWebSocket *server, uint32_t client, bool ok, const char *action, size_t actionLen) {
+    WsFrame *frame;
+    if (server == &wsBin) {
+        frame = wsFrameAlloc(WS_ACK_HEADER_LEN + WS_ACK_ACTION_MAX, true);
+        if (frame == NULL) return;
+        frame->len = encodeAckFrame(ok, action, actionLen, frame->data, frame->len);
+    } else {
+        char text[WS_ACK_ACTION_MAX + 32];
+        int len = snprintf(text, sizeof(text), "{\"ack\":\"%.*s\",\"ok\":%s}",
+                           (int)(actionLen > WS_ACK_ACTION_MAX ? WS_ACK_ACTION_MAX : actionLen), action,
+                           ok ? "true" : "false");
+        frame = wsFrameAlloc(len, false);
+        if (frame == NULL) return;
+        memcpy(frame->data, text, len);
+    }
+    wsQueueTo(server, client, WsFrameClass::ACK, frame);
+    wsFrameRelease(frame);
+}
+
+// Runs the commands queued by the network callbacks, in the control task.
+// The acks are sent by the network task, a command waits in the queue
+// until there is room for its ack.
+void runLoopCommands() {
+    LoopCommand c;
+    while (commandAcks.size() < LOOP_QUEUE_LEN && loopCommands.pop(c)) {
+        c.handler(c.arg);
+        if (c.ack) {
+            CommandAck a = { c.server, c.client, c.ack };
+            commandAcks.push(a);
         }
-        if (strcmp(action, "SW") == 0) {
-            wanted_dir = 6;
+    }
+}
+
+void handleWebSocketMessage(AsyncWebSocket *server, AsyncWebSocketClient *client, void *arg, uint8_t *data, size_t len) {
+    AwsFrameInfo *info = (AwsFrameInfo*)arg;
+    if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
+
+        const char *action;
+        size_t actionLen;
+        if (!wsFindAction(data, len, &action, &actionLen)) {
+            Serial.println(F("WebSocket frame without action"));
+            return;
         }
-        if (strcmp(action, "W") == 0) {
-            wanted_dir = 7;
+
+        const WsCommand *cmd = wsLookup(WS_COMMANDS, WS_COMMAND_COUNT, action, actionLen);
+        if (cmd == NULL) {
+            Serial.printf("Unknown action '%.*s'\n", (int)actionLen, action);
+            sendAck(server, client->id(), false, action, actionLen);
+            return;
         }
-        if (strcmp(action, "NW") == 0) {
-            wanted_dir = 8;
+        LoopCommand c = { WS_HANDLERS[(uint8_t)cmd->action], cmd->arg, cmd->name, server, client->id() };
+        if (!loopCommands.push(c)) {
+            commandsRejected++;
+            sendAck(server, client->id(), false, action, actionLen);
         }
-
-
     }
 }
 
@@ -247,12 +1081,18 @@ void onEvent(AsyncWebSocket       *server,
     switch (type) {
         case WS_EVT_CONNECT:
             Serial.printf("WebSocket client #%u connected from %s\n", client->id(), client->remoteIP().toString().c_str());
+            wsAddPeer(server, client);
+            wsHookClient(client);
+            sendInitialState(server, client->id());
+            wsPumpClient(client);
             break;
         case WS_EVT_DISCONNECT:
             Serial.printf("WebSocket client #%u disconnected\n", client->id());
+            wsRemovePeer(server, client);
             break;
         case WS_EVT_DATA:
-            handleWebSocketMessage(arg, data, len);
+            handleWebSocketMessage(server, client, arg, data, len);
+            wsPumpClient(client);
             break;
         case WS_EVT_PONG:
         case WS_EVT_ERROR:
@@ -263,6 +1103,8 @@ void onEvent(AsyncWebSocket       *server,
 void initWebSocket() {
     ws.onEvent(onEvent);
     server.addHandler(&ws);
+    wsBin.onEvent(onEvent);
+    server.addHandler(&wsBin);
 }
 
 void initStrip() {
@@ -273,9 +1115,20 @@ void initStrip() {
 // Initialization
 // ----------------------------------------------------------------------------
 
+// Task entry points and scheduler jobs, defined below
+void controlStep(void *);
+void inputsJob(void *);
+void inputsDebounceJob(void *);
+void relaysJob(void *);
+void swrLedsJob(void *);
+void cleanupJob(void *);
+void broadcastJob(void *);
+void uiJob(void *);
+void statusJob(void *);
+
 void setup() {
     pinMode(led.pin,         OUTPUT);
-    pinMode(button.pin,      INPUT);
+    pinMode(BTN_PIN,         INPUT);
     pinMode(NEO_PIN,         OUTPUT);
 
     Serial.begin(115200); delay(500);
@@ -286,89 +1139,275 @@ void setup() {
     initWebServer();
     initStrip();
     initRotarySwitch();
-    lastRotaryDir = readRotarySwitch();
+    uint32_t in = sampleInputs();
+    inputs.begin(in, IN_BUTTON, BUTTON_LONG_TICKS, BUTTON_REPEAT_TICKS);
+    lastRotaryDir = decodeRotarySwitch(in & IN_ROTARY_MASK);
     
     initSWRDisplay();
+    initSWRCalibration();
+    if (!swrHistory.begin()) Serial.println("Cannot allocate SWR history");
+#ifdef AMP_INHIBIT_PIN
+    pinMode(AMP_INHIBIT_PIN, OUTPUT);
+    digitalWrite(AMP_INHIBIT_PIN, LOW);
+#endif
+    swrGuard.begin(fwdCal, refCal, ADC_SAMPLE_HZ, onSwrTrip, NULL);
+    swrGuard.setLimits(SWR_TRIP_Q8, SWR_TRIP_MIN_MW, SWR_RF_MW);
+    swrCapture.begin(swrAdc);
+    swrAdc.onSample(onSwrSample, NULL);
+    if (!swrAdc.begin(readSWRPins, NULL)) Serial.println("Cannot start SWR sampling");
+#ifdef SWR_COMP_PIN
+    pinMode(SWR_COMP_PIN, INPUT_PULLUP);
+    attachInterrupt(SWR_COMP_PIN, onSwrComparator, FALLING);
+#endif
+    setSWRHysteresis(40);
+    setSWRDisplayMode(SWR_MODE_DECAY, 1000, 100);
     strip.setPixelColor(0, 0, 50, 0);
     strip.show();
 
     Serial.printf("Init I2C");
     Wire.begin(SDA_PIN, SCL_PIN);
-    ioex1.attach(Wire);
-    ioex1.setDeviceAddress(IO_EXP_1_ADDR);
-    ioex1.config(TCA9539::Port::PORT1, TCA9539::Config::OUT);
-    ioex1.config(TCA9539::Port::PORT2, TCA9539::Config::OUT);
+    relayBus.addDevice(Wire, i2c, IO_EXP_1_ADDR, IO_EXP_1_INPUTS);
+#ifdef SDA1_PIN
+    Wire1.begin(SDA1_PIN, SCL1_PIN);
+    // add the expanders on the second bus here, e.g.
+    // relayBus.addDevice(Wire1, i2c1, 0x75);
+#endif
+    if (!relayBus.begin()) Serial.println("TCA9539 setup failed");
     Serial.printf("Init I2C DONE!");
+
+    if (!i2c.begin(Wire, SDA_PIN, SCL_PIN, "i2c0")) Serial.println("Cannot start I2C worker");
+#ifdef SDA1_PIN
+    if (!i2c1.begin(Wire1, SDA1_PIN, SCL1_PIN, "i2c1")) Serial.println("Cannot start I2C1 worker");
+#endif
+#ifdef IO_EXP_1_INT
+    ioex1Inputs.subscribe(1 << PTT_SENSE_PIN, onExpanderInput);
+    ioex1Inputs.begin(i2c, IO_EXP_1_ADDR, IO_EXP_1_INT);
+#endif
+
+    relays.begin({ writeRelays, confirmRelays, relayInterlockOk });
+    relays.setConfirmTime(RELAY_CONFIRM_TIMEOUT_MS);
+    stateBcast.begin(BCAST_INTERVAL_MS, BCAST_HEARTBEAT_MS);
+    publishState();
+
+    // name, period ms, budget us
+    controlJobs.add("inputs",   inputsJob,         NULL, 5,  500);
+    controlJobs.add("debounce", inputsDebounceJob, NULL, 5,  200);   // InputBank tick, every cycle
+    controlJobs.add("relays",   relaysJob,         NULL, 5,  500);
+    controlJobs.add("swr_leds", swrLedsJob,        NULL, 20, 200);
+    netJobs.add("cleanup",      cleanupJob,  NULL, 1000, 1000);
+    netJobs.add("broadcast",    broadcastJob, NULL, 10, 3000);
+    netJobs.add("ui",           uiJob,       NULL, 50, 3000);
+    netJobs.add("status",       statusJob,   NULL, 1000, 5000);
+
+    if (!controlTask.begin("control", controlStep, NULL, CONTROL_PERIOD_MS, CONTROL_CORE, CONTROL_PRIORITY)) {
+        Serial.println("Cannot start control task");
+    }
+    if (!netJobs.begin("net", NET_CORE, NET_PRIORITY, 8192)) {
+        Serial.println("Cannot start network task");
+    }
 }
 
 // ----------------------------------------------------------------------------
-// Main control loop
+// Control task
 // ----------------------------------------------------------------------------
+// Everything that reads inputs or drives the relays, every CONTROL_PERIOD_MS
+// at high priority. It never waits for the bus or the network. The jobs
+// run in the order they are added in setup().
 
-void loop() {
-    ws.cleanupClients();
+void inputsJob(void *) {
+    i2c.poll();
+#ifdef SDA1_PIN
+    i2c1.poll();
+#endif
+#ifdef IO_EXP_1_INT
+    ioex1Inputs.update();
+#endif
+    runLoopCommands();
 
-    // Send state update to web clients once every second
-    if (millis() - lastNotifyClientMillis >= 1000UL) 
-    {
-        lastNotifyClientMillis = millis();  //get ready for the next iteration
-        notifyClients();
-        
-        Serial.printf("SWR meas: %d\n", analogRead(16));
+    AdcReading swr;
+    if (swrAdc.latest(swr) && swr.count != lastReadingCount) {
+        lastReadingCount = swr.count;
+        computeSWR(fwdCal, refCal, swr.value[ADC_CH_FWD], swr.value[ADC_CH_REF], swr_meas);
+        swrHistory.add(swr_meas, actual_dir, swr.timestamp);
+        scan.addReading(swr_meas);
     }
 
-
-   
-    // Check rotary switch for changes
-    uint8_t newDir = readRotarySwitch();
-    if (lastRotaryDir != newDir) {
-        // Setting of rotary switch changed
-        // Update wanted direction
-        lastRotaryDir = newDir;
-        wanted_dir = newDir;
+    // interlock and scan state changes are pushed at once
+    uint8_t flags = readStateFlags();
+    if (flags != stateFlags) {
+        stateFlags = flags;
+        stateChanged();
     }
-    
+}
 
-    
-    // check if a new direction is wanted:
-    if (actual_dir != wanted_dir)
-    {
-        // Check here if it is safe to switch direction, always true for now
-        if (true)
-        {
-            /* switch the actual relays here */
-            actual_dir = wanted_dir; // update the actual direction variable
-            notifyClients();
+void inputsDebounceJob(void *) {
+    const InputEvents &e = inputs.tick(sampleInputs());
+
+    // the contacts are debounced one by one, the position only counts
+    // once all of them have settled
+    if ((e.pressed | e.released) & IN_ROTARY_MASK) {
+        rotaryChangedAt = inputs.ticks();
+        rotaryPending   = true;
+    }
+    if (rotaryPending && inputs.ticks() - rotaryChangedAt >= ROTSW_SETTLE_TICKS) {
+        rotaryPending = false;
+        uint8_t newDir = decodeRotarySwitch(inputs.state() & IN_ROTARY_MASK);
+        if (lastRotaryDir != newDir) {
+            // Setting of rotary switch changed
+            // Update wanted direction
+            lastRotaryDir = newDir;
+            scan.abort(SCAN_ABORT_ROTARY, newDir, millis());
+            wanted_dir = newDir;
         }
     }
 
-    setSWRLeds(map(analogRead(16),0,4095,0,10));
+    if (e.pressed & IN_BUTTON) {
+        buttonPresses++;
+        led.on = !led.on;
+        stateChanged();
+    }
+    if (e.longPress & IN_BUTTON) buttonLongPresses++;
+}
 
-    
-    button.read();
-    if (button.pressed()) {
+void relaysJob(void *) {
+    // a running scan picks the direction, real RF stops it
+    if (scan.running() && swrGuard.rfPresent()) {
+        scan.abort(SCAN_ABORT_RF, scan.returnDirection(), millis());
+    }
+    if (scan.running()) wanted_dir = scan.direction();
+
+    // check if a new direction is wanted, the sequencer releases the old
+    // relay, waits for it to settle and for the interlocks before
+    // energising the new one
+    if (relays.target() != wanted_dir) {
+        relays.request(wanted_dir, millis());
+        stateChanged();
+    }
+    if (relays.update(millis())) {
+        actual_dir = relays.current();
+        swrCapture.setDirection(actual_dir);
+        stateChanged();
+    }
+
+    if (scan.update(millis(), relays.current(), relays.busy())) {
+        wanted_dir = scan.direction();
+        publishScan();
+    }
+}
+
+void swrLedsJob(void *) {
+    updateSWRDisplay(swrDisplayValue(swr_meas));
+}
+
+void controlStep(void *) {
+    // the control jobs run on the cycle grid, not on millis()
+    controlJobs.runDue(controlClock);
+    controlClock += CONTROL_PERIOD_MS;
+
+    led.update();
+    publishState();
+}
+
+// ----------------------------------------------------------------------------
+// Network task
+// ----------------------------------------------------------------------------
+// Web clients, the NeoPixel and the Serial console at low priority, the
+// task sleeps between the job releases. It only sees the control state
+// through the snapshot.
+
+void cleanupJob(void *) {
+    ws.cleanupClients();
+    wsBin.cleanupClients();
+}
+
+void broadcastJob(void *) {
+    StateSnapshot st;
+    stateSnapshot.read(st);
+    if (st.version != seenStateVersion) {
+        seenStateVersion = st.version;
+        stateBcast.markDirty(millis());
+    }
+
+    // a capture completed in the sampler task
+    uint32_t captureId = swrCapture.latest();
+    if (captureId != lastCaptureId) {
+        lastCaptureId = captureId;
+        notifyCapture(captureId, st.actualDir);
+    }
+
+    // a sweep ended in the control task
+    if (scanReport.writes() != seenScanReports) {
+        ScanReport r;
+        seenScanReports = scanReport.read(r);
+        notifyScan(r);
+    }
+
+    CommandAck a;
+    while (commandAcks.pop(a)) sendAck(a.server, a.client, true, a.action, strlen(a.action));
+
+    // at most one state frame per interval, the heartbeat only when the
+    // SWR moved
+    if (stateBcast.poll(millis(), st.swr.swrQ8 != notifiedSwr)) notifyClients();
+    wsReapPeers();
+}
+
+void uiJob(void *) {
+    StateSnapshot st;
+    stateSnapshot.read(st);
+    if ((st.flags & WS_FLAG_SWR_TRIP) && !(shownFlags & WS_FLAG_SWR_TRIP)) {
+        Serial.printf("SWR interlock tripped (cause %u), %lu us\n",
+                      swrGuard.cause(), (unsigned long)swrGuard.lastLatency());
+    }
+    if ((st.flags & WS_FLAG_RELAY_FAULT) && !(shownFlags & WS_FLAG_RELAY_FAULT)) {
+        Serial.printf("Relays did not switch to %u (%lu faults), retrying\n",
+                      st.wantedDir, (unsigned long)relays.faults());
+    }
+    if ((shownFlags & WS_FLAG_SCAN) && !(st.flags & WS_FLAG_SCAN)) {
+        Serial.printf("Scan ended (%u) after %lu ms\n", scan.status(), (unsigned long)scan.lastDuration());
+    }
+    shownFlags = st.flags;
+    if (st.actualDir != shownDir) {
+        shownDir = st.actualDir;
+        if (shownDir) printRelayHistogram();
+    }
+
+    // the pixel stays green from setup() until the LED is first switched
+    if (st.ledOn != stripLedOn) {
+        stripLedOn = st.ledOn;
         Serial.printf(" %s\n", WiFi.localIP().toString().c_str());
-        led.on = !led.on;
-        if (led.on) {
+        if (stripLedOn) {
             strip.setPixelColor(0, 100, 0, 0);
         } else {
             strip.setPixelColor(0, 0, 0, 0);
-        }        
-        notifyClients();
-        /*
-        // Set all pins(8) on entire port:
-        ioex1.output(TCA9539::Port::PORT2, 0xFF);
-        delay(1000);
-        ioex1.output(TCA9539::Port::PORT2, 0x00);
-        delay(1000);
-
-        // Set one pin only:
-        ioex1.output(TCA9539::Port::PORT2, 2, 1);
-        delay(1000);
-        ioex1.output(TCA9539::Port::PORT2, 2, 0);
-        delay(1000);
-        */
+        }
+        strip.show();
     }
-    strip.show();
-    led.update();
+}
+
+// Prints the status once every second
+void statusJob(void *) {
+    StateSnapshot st;
+    stateSnapshot.read(st);
+    Serial.printf("Fwd %lu mW, ref %lu mW, SWR %u.%02u, RL %u.%u dB\n",
+                  (unsigned long)st.swr.fwdMw, (unsigned long)st.swr.refMw,
+                  st.swr.swrQ8 >> 8, ((st.swr.swrQ8 & 0xff) * 100) >> 8,
+                  st.swr.returnLossDb10 / 10, st.swr.returnLossDb10 % 10);
+    if (rotarySwitchFault()) {
+        Serial.printf("Rotary switch fault, several contacts closed (%lu)\n", (unsigned long)rotarySwitchFaults());
+    }
+#ifdef IO_EXP_1_INT
+    Serial.printf("IO expander input events: %lu, latency %lu us (max %lu us)\n",
+                  (unsigned long)ioex1Inputs.events(),
+                  (unsigned long)ioex1Inputs.lastLatency(),
+                  (unsigned long)ioex1Inputs.maxLatency());
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// Main control loop
+// ----------------------------------------------------------------------------
+
+// All the work is done by the control and network tasks
+void loop() {
+    vTaskDelete(NULL);
 }
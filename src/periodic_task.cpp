@@ -0,0 +1,42 @@
+#include "periodic_task.h"
+
+bool PeriodicTask::begin(const char *name, PeriodicStep step, void *ctx, uint16_t period,
+                         BaseType_t core, UBaseType_t priority, uint32_t stackSize) {
+    stepFn   = step;
+    stepCtx  = ctx;
+    periodMs = period ? period : 1;
+    return xTaskCreatePinnedToCore(taskEntry, name, stackSize, this, priority, &task, core) == pdPASS;
+}
+
+void PeriodicTask::taskEntry(void *arg) {
+    PeriodicTask *self = static_cast<PeriodicTask *>(arg);
+    for (;;) {
+        // start right after a tick, so the micros() grid lines up with the ticks
+        vTaskDelay(1);
+        TickType_t lastWake = xTaskGetTickCount();
+        uint32_t release = micros();
+        while (self->cycle(release)) {
+            release += self->periodMs * 1000UL;
+            vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(self->periodMs));
+        }
+        // an overrun restarts the schedule instead of catching up
+    }
+}
+
+bool PeriodicTask::cycle(uint32_t release) {
+    uint32_t start = micros();
+    stepFn(stepCtx);
+    uint32_t end = micros();
+
+    // the tick can fire a little before the micros() grid, that is no delay
+    int32_t late = (int32_t)(start - release);
+    lastJitterUs = late > 0 ? late : 0;
+    if (lastJitterUs > maxJitterUs) maxJitterUs = lastJitterUs;
+    lastCycleUs = end - start;
+    if (lastCycleUs > maxCycleUs) maxCycleUs = lastCycleUs;
+    cycleCount++;
+
+    if ((int32_t)(end - (release + periodMs * 1000UL)) < 0) return true;
+    overrunCount++;
+    return false;
+}
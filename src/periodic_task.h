@@ -0,0 +1,58 @@
+#ifndef PERIODIC_TASK_H_
+#define PERIODIC_TASK_H_
+
+#include <Arduino.h>
+
+// ----------------------------------------------------------------------------
+// Fixed-period task
+// ----------------------------------------------------------------------------
+//
+// Runs a step function once per period in its own task, pinned to a core.
+// The task sleeps with vTaskDelayUntil(), so the releases stay on a fixed
+// grid whatever a step costs, and every cycle is timed with micros():
+//
+//   jitter  how long after its release a step started
+//   cycle   how long the step ran
+//
+// A step that finishes after the next release is an overrun. The schedule
+// then restarts at the next tick instead of running the missed steps back
+// to back. The counters are written by the task; individual counters can be
+// read from any task, a set of them is not a consistent snapshot.
+
+typedef void (*PeriodicStep)(void *ctx);
+
+class PeriodicTask {
+public:
+    bool begin(const char *name, PeriodicStep step, void *ctx, uint16_t periodMs,
+               BaseType_t core, UBaseType_t priority, uint32_t stackSize = 4096);
+
+    // Runs and times one step released at release (micros()). Called by
+    // the task, can be stepped directly without it. Returns false when the
+    // step ran past the next release.
+    bool cycle(uint32_t release);
+
+    uint16_t period()     const { return periodMs; }
+    uint32_t cycles()     const { return cycleCount; }
+    uint32_t overruns()   const { return overrunCount; }
+    uint32_t lastCycle()  const { return lastCycleUs; }
+    uint32_t maxCycle()   const { return maxCycleUs; }
+    uint32_t lastJitter() const { return lastJitterUs; }
+    uint32_t maxJitter()  const { return maxJitterUs; }
+
+private:
+    static void taskEntry(void *arg);
+
+    PeriodicStep stepFn = NULL;
+    void        *stepCtx = NULL;
+    uint16_t     periodMs = 1;
+    TaskHandle_t task = NULL;
+
+    volatile uint32_t cycleCount   = 0;
+    volatile uint32_t overrunCount = 0;
+    volatile uint32_t lastCycleUs  = 0;
+    volatile uint32_t maxCycleUs   = 0;
+    volatile uint32_t lastJitterUs = 0;
+    volatile uint32_t maxJitterUs  = 0;
+};
+
+#endif /* PERIODIC_TASK_H_ */
@@ -0,0 +1,128 @@
+#include "relay_seq.h"
+
+static const uint16_t HIST_BOUNDS[RELAY_HIST_BUCKETS - 1] = {
+    10, 20, 25, 30, 40, 50, 75, 100, 200
+};
+
+uint16_t RelaySequencer::histogramBound(uint8_t bucket) {
+    return bucket < RELAY_HIST_BUCKETS - 1 ? HIST_BOUNDS[bucket] : 0xffff;
+}
+
+void RelaySequencer::begin(const RelayDriver &driver, uint16_t settle) {
+    drv        = driver;
+    settleMs   = settle;
+    st         = State::IDLE;
+    targetDir  = 0;
+    currentDir = 0;
+}
+
+void RelaySequencer::request(uint8_t dir, uint32_t now) {
+    if (dir == targetDir && st != State::FAULT) return;
+
+    targetDir   = dir;
+    requestedAt = now;
+
+    // While nothing is energised yet, just retarget the running sequence.
+    if (st == State::RELEASE || st == State::RELEASED || st == State::SETTLE || st == State::INTERLOCK) return;
+    enter(State::RELEASE, now);
+}
+
+void RelaySequencer::retry(uint32_t now) {
+    if (st == State::FAULT) enter(State::RELEASE, now);
+}
+
+void RelaySequencer::enter(State s, uint32_t now) {
+    st = s;
+    switch (s) {
+        case State::SETTLE:  deadline = now + settleMs;         break;
+        case State::RELEASED:
+        case State::CONFIRM: deadline = now + confirmMs;        break;
+        case State::FAULT:   deadline = now + RELAY_RETRY_MS;   break;
+        default: break;
+    }
+}
+
+void RelaySequencer::record(uint32_t latency) {
+    lastLatencyMs = latency;
+    if (latency > maxLatencyMs) maxLatencyMs = latency;
+    uint8_t b = 0;
+    while (b < RELAY_HIST_BUCKETS - 1 && latency >= HIST_BOUNDS[b]) b++;
+    hist[b]++;
+}
+
+bool RelaySequencer::update(uint32_t now) {
+    switch (st) {
+        case State::IDLE:
+            return false;
+
+        case State::FAULT:
+            // start over from a release, whatever the relays did
+            if ((int32_t)(now - deadline) >= 0) enter(State::RELEASE, now);
+            return false;
+
+        case State::RELEASE:
+            // neither drop nor make a relay contact under RF
+            if (!drv.interlockOk()) return false;
+            if (!drv.write(0)) {
+                faultCount++;
+                enter(State::FAULT, now);
+                return false;
+            }
+            enter(State::RELEASED, now);
+            return false;
+
+        case State::RELEASED: {
+            int8_t r = drv.confirm(0);
+            if (r > 0) {
+                bool changed = currentDir != 0;
+                currentDir = 0;
+                enter(State::SETTLE, now);
+                return changed;
+            }
+            if (r < 0 || (int32_t)(now - deadline) >= 0) {
+                faultCount++;
+                enter(State::FAULT, now);
+            }
+            return false;
+        }
+
+        case State::SETTLE:
+            if ((int32_t)(now - deadline) >= 0) enter(State::INTERLOCK, now);
+            return false;
+
+        case State::INTERLOCK:
+            // relays stay released until it is safe to energise the new one
+            if (targetDir == 0) {
+                enter(State::CONFIRM, now);
+            } else if (drv.interlockOk()) {
+                enter(State::ENERGISE, now);
+            }
+            return false;
+
+        case State::ENERGISE:
+            if (!drv.write(RELAY_DIR_MASK(targetDir))) {
+                faultCount++;
+                enter(State::FAULT, now);
+                return false;
+            }
+            enter(State::CONFIRM, now);
+            return false;
+
+        case State::CONFIRM: {
+            int8_t r = drv.confirm(RELAY_DIR_MASK(targetDir));
+            if (r > 0) {
+                record(now - requestedAt);
+                bool changed = currentDir != targetDir;
+                currentDir = targetDir;
+                enter(State::IDLE, now);
+                return changed;
+            }
+            if (r < 0 || (int32_t)(now - deadline) >= 0) {
+                faultCount++;
+                enter(State::FAULT, now);
+            }
+            return false;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,94 @@
+#ifndef RELAY_SEQ_H_
+#define RELAY_SEQ_H_
+
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+// Break-before-make relay sequencer
+// ----------------------------------------------------------------------------
+//
+// A direction change walks through
+//
+//   RELEASE -> RELEASED -> SETTLE -> INTERLOCK -> ENERGISE -> CONFIRM -> IDLE
+//
+// one step per update() call. RELEASE and INTERLOCK both wait for the
+// driver's interlock, so a change requested under RF is held off before
+// anything is touched. The settle time only starts once the driver
+// confirms the release, so a driver that writes asynchronously cannot end up
+// energising the new relay before the old one has dropped. Waiting is done
+// against millis() deadlines, so update() never blocks and is meant to be
+// called on every loop() pass.
+// Hardware access goes through a RelayDriver so the sequencer does not depend
+// on how the relays are wired.
+//
+// A write error or a relay that does not confirm ends in FAULT. The sequence
+// is started over after RELAY_RETRY_MS, or at once by retry() or by a
+// request() for any direction.
+
+#define RELAY_SETTLE_MS         20      // default time between release and energise
+#define RELAY_CONFIRM_MS        50      // default max time for the outputs to read back
+#define RELAY_RETRY_MS          1000    // FAULT backoff before the next attempt
+#define RELAY_HIST_BUCKETS      10
+
+// Relay mask for direction 1..8, one relay per direction on PORT1
+#define RELAY_DIR_MASK(dir)     ((dir) ? (uint16_t)(1u << ((dir) - 1)) : (uint16_t)0)
+
+struct RelayDriver {
+    // drives the relay outputs, returns false on a bus error
+    bool   (*write)(uint16_t mask);
+    // 1 = outputs read back as mask, 0 = not yet known, -1 = mismatch/error
+    int8_t (*confirm)(uint16_t mask);
+    // false while it is unsafe to energise a relay (RF present, PTT, ...)
+    bool   (*interlockOk)();
+};
+
+class RelaySequencer {
+public:
+    enum class State : uint8_t { IDLE, RELEASE, RELEASED, SETTLE, INTERLOCK, ENERGISE, CONFIRM, FAULT };
+
+    void begin(const RelayDriver &driver, uint16_t settleMs = RELAY_SETTLE_MS);
+    void setSettleTime(uint16_t ms) { settleMs = ms; }
+    // has to cover the driver's worst case from write() to confirm()
+    void setConfirmTime(uint16_t ms) { confirmMs = ms; }
+
+    // Starts (or retargets) a switch to dir. Cheap to call repeatedly.
+    void request(uint8_t dir, uint32_t now);
+
+    // Starts the sequence to target() over if it is in FAULT
+    void retry(uint32_t now);
+
+    // Advances the state machine. Returns true when current() changed.
+    bool update(uint32_t now);
+
+    State   state()   const { return st; }
+    bool    busy()    const { return st != State::IDLE && st != State::FAULT; }
+    uint8_t target()  const { return targetDir; }
+    uint8_t current() const { return currentDir; }
+    uint32_t faults() const { return faultCount; }
+
+    // Switch-to-confirmed latency histogram, bucket i counts latencies below
+    // histogramBound(i) ms, the last bucket everything above.
+    uint32_t histogram(uint8_t bucket) const { return hist[bucket]; }
+    static uint16_t histogramBound(uint8_t bucket);
+    uint32_t lastLatency() const { return lastLatencyMs; }
+    uint32_t maxLatency()  const { return maxLatencyMs; }
+
+private:
+    void enter(State s, uint32_t now);
+    void record(uint32_t latency);
+
+    RelayDriver drv;
+    State    st          = State::IDLE;
+    uint8_t  targetDir   = 0;
+    uint8_t  currentDir  = 0;
+    uint16_t settleMs    = RELAY_SETTLE_MS;
+    uint16_t confirmMs   = RELAY_CONFIRM_MS;
+    uint32_t requestedAt = 0;
+    uint32_t deadline    = 0;
+    uint32_t faultCount  = 0;
+    uint32_t lastLatencyMs = 0;
+    uint32_t maxLatencyMs  = 0;
+    uint32_t hist[RELAY_HIST_BUCKETS] = {};
+};
+
+#endif /* RELAY_SEQ_H_ */
@@ -1,29 +1,60 @@
-
 #include <Arduino.h>
 #include "rotswitch.h"
 
+static const uint8_t ROTSW_PINS[8] = {
+    ROTSW_01, ROTSW_02, ROTSW_03, ROTSW_04, ROTSW_05, ROTSW_06, ROTSW_07, ROTSW_08
+};
+
+// Contact code (bit n set = contact n+1 closed) to position
+static uint8_t decodeLut[256];
+
+// GPIO_IN_REG holds GPIO 0..31, GPIO_IN1_REG GPIO 32 and up
+static uint32_t loMask[8];
+static uint32_t hiMask[8];
+
+static uint8_t  position  = 0;
+static bool     fault     = false;
+static uint32_t faultCount = 0;
+
 void initRotarySwitch() {
-    pinMode(ROTSW_01,      INPUT_PULLDOWN);
-    pinMode(ROTSW_02,      INPUT_PULLDOWN);
-    pinMode(ROTSW_03,      INPUT_PULLDOWN);
-    pinMode(ROTSW_04,      INPUT_PULLDOWN);
-    pinMode(ROTSW_05,      INPUT_PULLDOWN);
-    pinMode(ROTSW_06,      INPUT_PULLDOWN);
-    pinMode(ROTSW_07,      INPUT_PULLDOWN);
-    pinMode(ROTSW_08,      INPUT_PULLDOWN);
+    decodeLut[0] = 0;
+    for (uint16_t code = 1; code < 256; code++) {
+        bool single = (code & (code - 1)) == 0;
+        decodeLut[code] = single ? __builtin_ctz(code) + 1 : ROTSW_FAULT;
+    }
+
+    for (uint8_t i = 0; i < 8; i++) {
+        uint8_t pin = ROTSW_PINS[i];
+        loMask[i] = pin < 32 ? (1UL << pin) : 0;
+        hiMask[i] = pin < 32 ? 0 : (1UL << (pin - 32));
+        pinMode(pin, INPUT_PULLDOWN);
+    }
 }
 
+uint8_t rotarySwitchContacts(uint32_t lo, uint32_t hi) {
+    uint8_t code = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        if ((lo & loMask[i]) || (hi & hiMask[i])) code |= 1 << i;
+    }
+    return code;
+}
 
-uint8_t readRotarySwitch() {
-    uint8_t position = 0;
-    if (digitalRead(ROTSW_01) == HIGH) position = 1;
-    else if (digitalRead(ROTSW_02) == HIGH) position = 2;
-    else if (digitalRead(ROTSW_03) == HIGH) position = 3;
-    else if (digitalRead(ROTSW_04) == HIGH) position = 4;
-    else if (digitalRead(ROTSW_05) == HIGH) position = 5;
-    else if (digitalRead(ROTSW_06) == HIGH) position = 6;
-    else if (digitalRead(ROTSW_07) == HIGH) position = 7;
-    else if (digitalRead(ROTSW_08) == HIGH) position = 8;
-    else position = 0;
+uint8_t decodeRotarySwitch(uint8_t contacts) {
+    uint8_t p = decodeLut[contacts];
+    if (p == ROTSW_FAULT) {
+        if (!fault) faultCount++;
+        fault = true;
+        return position;
+    }
+    fault    = false;
+    position = p;
     return position;
-}
\ No newline at end of file
+}
+
+bool rotarySwitchFault() {
+    return fault;
+}
+
+uint32_t rotarySwitchFaults() {
+    return faultCount;
+}
@@ -1,6 +1,8 @@
 #ifndef ROTSWITCH_H_
 #define ROTSWITCH_H_
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -14,11 +16,24 @@ extern "C" {
 #define ROTSW_07 12
 #define ROTSW_08 13
 
+#define ROTSW_FAULT     0xFF    // decoder result for several closed contacts
+
 void initRotarySwitch();
-uint8_t readRotarySwitch();
+
+// Contact code of the raw GPIO input registers (GPIO_IN_REG, GPIO_IN1_REG),
+// bit n set = contact n+1 closed. Debouncing is up to the caller.
+uint8_t rotarySwitchContacts(uint32_t lo, uint32_t hi);
+
+// Returns the position 1..8 of a debounced contact code, or 0 when no
+// contact is closed. A code with more than one closed contact is counted
+// as a fault and the last position is kept.
+uint8_t decodeRotarySwitch(uint8_t contacts);
+
+bool rotarySwitchFault();
+uint32_t rotarySwitchFaults();
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif /* ROTSWITCH_H_ */
\ No newline at end of file
+#endif /* ROTSWITCH_H_ */
@@ -0,0 +1,58 @@
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// ----------------------------------------------------------------------------
+// Seqlock
+// ----------------------------------------------------------------------------
+//
+// One writer publishes a value, any number of readers take consistent
+// copies without blocking the writer. The sequence number is odd while a
+// write is in progress, a reader retries when it changed during its copy.
+// The value is kept in relaxed atomic words, so concurrent copies are not
+// data races. T has to be trivially copyable.
+
+template <typename T>
+class Seqlock {
+public:
+    // single writer only
+    void write(const T &value) {
+        uint32_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++) data[i].store(words[i], std::memory_order_relaxed);
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    // Copies the latest value, returns the number of writes so far
+    uint32_t read(T &out) const {
+        uint32_t words[WORDS];
+        uint32_t s1, s2;
+        do {
+            s1 = seq.load(std::memory_order_acquire);
+            if (s1 & 1) continue;
+            for (size_t i = 0; i < WORDS; i++) words[i] = data[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            s2 = seq.load(std::memory_order_relaxed);
+            if (s1 == s2) break;
+        } while (true);
+        memcpy(&out, words, sizeof(T));
+        return s1 >> 1;
+    }
+
+    uint32_t writes() const { return seq.load(std::memory_order_acquire) >> 1; }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + 3) / 4;
+
+    std::atomic<uint32_t> data[WORDS] = {};
+    std::atomic<uint32_t> seq{0};
+};
+
+#endif /* SEQLOCK_H_ */
@@ -0,0 +1,48 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <stdint.h>
+#include <atomic>
+
+// ----------------------------------------------------------------------------
+// Single-producer single-consumer queue
+// ----------------------------------------------------------------------------
+//
+// Wait-free ring for handing items from one task to another: push() and
+// pop() never block and never spin. Each index is only written by its own
+// side. N must be a power of two.
+
+template <typename T, uint16_t N>
+class SpscQueue {
+    static_assert(N && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+    // producer side, false when full
+    bool push(const T &item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) >= N) return false;
+        slots[t & (N - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, false when empty
+    bool pop(T &item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        item = slots[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint16_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+private:
+    T slots[N];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+};
+
+#endif /* SPSC_QUEUE_H_ */
@@ -0,0 +1,37 @@
+#include "state_bcast.h"
+
+void StateBroadcaster::begin(uint16_t intervalMs, uint16_t heartbeatMs) {
+    interval  = intervalMs;
+    heartbeat = heartbeatMs;
+}
+
+void StateBroadcaster::markDirty(uint32_t now) {
+    if (isDirty) {
+        coalescedCount++;
+        return;
+    }
+    isDirty    = true;
+    dirtySince = now;
+}
+
+bool StateBroadcaster::poll(uint32_t now, bool telemetryChanged) {
+    if (!isDirty && now - lastBeatAt >= heartbeat) {
+        lastBeatAt = now;
+        if (telemetryChanged) {
+            markDirty(now);
+        } else {
+            skippedCount++;
+        }
+    }
+    if (!isDirty) return false;
+    if (sentOnce && now - lastSentAt < interval) return false;
+
+    isDirty    = false;
+    sentOnce   = true;
+    lastSentAt = now;
+    lastBeatAt = now;
+    frameCount++;
+    lastStaleMs = now - dirtySince;
+    if (lastStaleMs > maxStaleMs) maxStaleMs = lastStaleMs;
+    return true;
+}
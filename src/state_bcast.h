@@ -0,0 +1,55 @@
+#ifndef STATE_BCAST_H_
+#define STATE_BCAST_H_
+
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+// Coalescing state broadcaster
+// ----------------------------------------------------------------------------
+//
+// State changes only mark the state dirty. poll() decides when a frame goes
+// out: at most one per interval, so a burst of changes becomes one frame,
+// and right away for the first change after a quiet interval. Every
+// heartbeat period the telemetry (the SWR reading) is compared with what the
+// last frame carried, the heartbeat is skipped when it did not change.
+//
+// Staleness is the time from the first change of a frame to its send.
+// Runs against millis() from the network task, which owns it.
+
+#define BCAST_INTERVAL_MS   100     // minimum time between frames
+#define BCAST_HEARTBEAT_MS  1000
+
+class StateBroadcaster {
+public:
+    void begin(uint16_t intervalMs = BCAST_INTERVAL_MS, uint16_t heartbeatMs = BCAST_HEARTBEAT_MS);
+
+    void markDirty(uint32_t now);
+
+    // Returns true when a frame has to be sent now, and counts it as sent.
+    // telemetryChanged is only looked at when a heartbeat is due.
+    bool poll(uint32_t now, bool telemetryChanged);
+
+    bool     dirty()         const { return isDirty; }
+    uint32_t frames()        const { return frameCount; }
+    uint32_t coalesced()     const { return coalescedCount; }   // changes merged into a pending frame
+    uint32_t skippedBeats()  const { return skippedCount; }
+    uint32_t lastStaleness() const { return lastStaleMs; }
+    uint32_t maxStaleness()  const { return maxStaleMs; }
+
+private:
+    uint16_t interval    = BCAST_INTERVAL_MS;
+    uint16_t heartbeat   = BCAST_HEARTBEAT_MS;
+    bool     isDirty     = false;
+    bool     sentOnce    = false;
+    uint32_t dirtySince  = 0;
+    uint32_t lastSentAt  = 0;
+    uint32_t lastBeatAt  = 0;
+
+    uint32_t frameCount     = 0;
+    uint32_t coalescedCount = 0;
+    uint32_t skippedCount   = 0;
+    uint32_t lastStaleMs    = 0;
+    uint32_t maxStaleMs     = 0;
+};
+
+#endif /* STATE_BCAST_H_ */
@@ -0,0 +1,120 @@
+#include "swr_calc.h"
+
+// round(256 * log2(1 + m / 256)), fractional part of log2 in Q8
+static constexpr uint8_t LOG2_MANTISSA[256] = {
+      0,   1,   3,   4,   6,   7,   9,  10,  11,  13,  14,  16,  17,  18,  20,  21,
+     22,  24,  25,  26,  28,  29,  30,  32,  33,  34,  36,  37,  38,  40,  41,  42,
+     44,  45,  46,  47,  49,  50,  51,  52,  54,  55,  56,  57,  59,  60,  61,  62,
+     63,  65,  66,  67,  68,  69,  71,  72,  73,  74,  75,  77,  78,  79,  80,  81,
+     82,  84,  85,  86,  87,  88,  89,  90,  92,  93,  94,  95,  96,  97,  98,  99,
+    100, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112, 113, 114, 116, 117,
+    118, 119, 120, 121, 122, 123, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133,
+    134, 135, 136, 137, 138, 139, 140, 141, 142, 143, 144, 145, 146, 147, 148, 149,
+    150, 151, 152, 153, 154, 155, 155, 156, 157, 158, 159, 160, 161, 162, 163, 164,
+    165, 166, 167, 168, 169, 169, 170, 171, 172, 173, 174, 175, 176, 177, 178, 178,
+    179, 180, 181, 182, 183, 184, 185, 185, 186, 187, 188, 189, 190, 191, 192, 192,
+    193, 194, 195, 196, 197, 198, 198, 199, 200, 201, 202, 203, 203, 204, 205, 206,
+    207, 208, 208, 209, 210, 211, 212, 212, 213, 214, 215, 216, 216, 217, 218, 219,
+    220, 220, 221, 222, 223, 224, 224, 225, 226, 227, 228, 228, 229, 230, 231, 231,
+    232, 233, 234, 234, 235, 236, 237, 238, 238, 239, 240, 241, 241, 242, 243, 244,
+    244, 245, 246, 247, 247, 248, 249, 249, 250, 251, 252, 252, 253, 254, 255, 255,
+};
+
+// SWR in Q8 for log2(Pf / Pr) = i / 16, capped at SWR_Q8_MAX
+static constexpr uint16_t SWR_BY_LOG2[SWR_LOG2_STEPS + 1] = {
+    25574, 23638, 11820,  7882,  5913,  4732,  3945,  3383,  2962,  2635,  2373,  2159,
+     1981,  1830,  1701,  1590,  1492,  1406,  1330,  1262,  1200,  1145,  1095,  1049,
+     1007,   968,   933,   900,   870,   842,   815,   791,   768,   747,   726,   707,
+      690,   673,   657,   642,   627,   614,   601,   589,   577,   566,   556,   546,
+      536,   527,   518,   510,   502,   494,   487,   479,   473,   466,   460,   454,
+      448,   442,   437,   432,   427,   422,   417,   413,   408,   404,   400,   396,
+      392,   389,   385,   382,   378,   375,   372,   369,   366,   363,   360,   358,
+      355,   353,   350,   348,   345,   343,   341,   339,   337,   335,   333,   331,
+      329,   327,   326,   324,   322,   321,   319,   318,   316,   315,   313,   312,
+      311,   309,   308,   307,   306,   304,   303,   302,   301,   300,   299,   298,
+      297,   296,   295,   294,   293,   293,   292,   291,   290,   289,   289,   288,
+      287,   286,   286,   285,   284,   284,   283,   283,   282,   281,   281,   280,
+      280,   279,   279,   278,   278,   277,   277,   276,   276,   275,   275,   274,
+      274,   274,   273,   273,   273,   272,   272,   271,   271,   271,   270,   270,
+      270,   270,   269,   269,   269,   268,   268,   268,   268,   267,   267,   267,
+      267,   266,   266,   266,   266,   265,   265,   265,   265,   265,   264,   264,
+      264,   264,   264,   264,   263,   263,   263,   263,   263,   263,   263,   262,
+      262,   262,   262,   262,   262,   262,   261,   261,   261,   261,   261,   261,
+      261,   261,   261,   260,   260,   260,   260,   260,   260,   260,   260,   260,
+      260,   260,   260,   259,   259,   259,   259,   259,   259,   259,   259,   259,
+      259,   259,   259,   259,   259,   259,   258,   258,   258,   258,   258,   258,
+      258,   258,   258,   258,   258,   258,   258,   258,   258,   258,   258,   258,
+      258,   258,   258,   258,   258,   258,   257,   257,   257,   257,   257,   257,
+      257,   257,   257,   257,   257,   257,   257,   257,   257,   257,   257,   257,
+      257,   257,   257,   257,   257,   257,   257,   257,   257,   257,   257,   257,
+      257,   257,   257,   257,   257,   257,   257,   257,   257,   257,   257,   257,
+      257,   257,   257,   257,   257,   257,   257,   257,   257,
+};
+
+bool PowerCurve::load(const CalPoint *points, uint8_t count) {
+    if (count < 2 || count > SWR_CAL_MAX_POINTS) return false;
+    for (uint8_t i = 1; i < count; i++) {
+        if (points[i].adc <= points[i - 1].adc || points[i].mw < points[i - 1].mw) return false;
+        uint32_t rise = points[i].mw - points[i - 1].mw;
+        if (rise / (points[i].adc - points[i - 1].adc) > SWR_CAL_MAX_SLOPE_MW) return false;
+    }
+    for (uint8_t i = 0; i < count; i++) pts[i] = points[i];
+    for (uint8_t i = 0; i + 1 < count; i++) {
+        uint64_t rise = (uint64_t)(pts[i + 1].mw - pts[i].mw) << 16;
+        slope[i] = rise / (pts[i + 1].adc - pts[i].adc);
+    }
+    n = count;
+    return true;
+}
+
+uint32_t PowerCurve::milliwatts(uint16_t adc) const {
+    if (n < 2) return 0;
+    if (adc <= pts[0].adc) return pts[0].mw;
+    if (adc >= pts[n - 1].adc) return pts[n - 1].mw;
+    uint8_t i = 0;
+    while (adc >= pts[i + 1].adc) i++;
+    return pts[i].mw + (uint32_t)(((uint64_t)slope[i] * (adc - pts[i].adc)) >> 16);
+}
+
+int32_t log2Q8(uint32_t x) {
+    if (x == 0) return 0;
+    uint8_t msb = 31 - __builtin_clz(x);
+    uint8_t mantissa = msb >= 8 ? (uint8_t)(x >> (msb - 8)) : (uint8_t)(x << (8 - msb));
+    return ((int32_t)msb << 8) + LOG2_MANTISSA[mantissa];
+}
+
+void computeSWR(const PowerCurve &fwd, const PowerCurve &ref, uint16_t fwdAdc, uint16_t refAdc, SwrResult &out) {
+    out.fwdMw = fwd.milliwatts(fwdAdc);
+    out.refMw = ref.milliwatts(refAdc);
+
+    if (out.fwdMw == 0) {
+        out.swrQ8          = 0;
+        out.returnLossDb10 = 0;
+        return;
+    }
+    if (out.refMw == 0) {
+        out.swrQ8          = SWR_Q8_MIN;
+        out.returnLossDb10 = SWR_RL_MAX_DB10;
+        return;
+    }
+
+    // d = log2(Pf / Pr) in Q8, return loss = 10 log10(2) d
+    int32_t d = log2Q8(out.fwdMw) - log2Q8(out.refMw);
+    if (d <= 0) {
+        out.swrQ8          = SWR_Q8_MAX;
+        out.returnLossDb10 = 0;
+        return;
+    }
+    uint32_t rl = ((uint32_t)d * 7706) >> 16;     // 100 log10(2) / 256 in Q16
+    out.returnLossDb10 = rl > SWR_RL_MAX_DB10 ? SWR_RL_MAX_DB10 : rl;
+
+    uint32_t idx = (uint32_t)d >> 4;
+    if (idx >= SWR_LOG2_STEPS) {
+        out.swrQ8 = SWR_BY_LOG2[SWR_LOG2_STEPS];
+        return;
+    }
+    uint32_t frac = (uint32_t)d & 15;
+    int32_t a = SWR_BY_LOG2[idx];
+    int32_t b = SWR_BY_LOG2[idx + 1];
+    out.swrQ8 = (uint16_t)(a + (((b - a) * (int32_t)frac) >> 4));
+}
@@ -0,0 +1,79 @@
+#ifndef SWR_CALC_H_
+#define SWR_CALC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ----------------------------------------------------------------------------
+// Calibrated forward/reflected power and SWR
+// ----------------------------------------------------------------------------
+//
+// Each detector channel is converted from ADC counts to milliwatts with a
+// piecewise-linear calibration curve. The built-in curves are constexpr
+// tables and can be replaced at runtime (see initSWRCalibration() in
+// main.cpp). Segment slopes are precomputed when a curve is loaded, so the
+// per-sample path is table lookups, multiplies and shifts only:
+//
+//   d    = log2(Pf) - log2(Pr)         clz + mantissa table, Q8
+//   RL   = 10 log10(2) * d             one multiply
+//   SWR  = SWR_BY_LOG2[d]              interpolated table, Q8
+//
+// No Arduino dependencies, builds on the host as well.
+
+#define SWR_CAL_MAX_POINTS  16
+#define SWR_LOG2_STEPS      320         // SWR table covers log2(Pf/Pr) 0..20 in 1/16 steps
+#define SWR_Q8_MIN          256         // 1.00
+#define SWR_Q8_MAX          25574       // 99.9, reported when Pr >= Pf
+#define SWR_RL_MAX_DB10     600         // 60.0 dB
+#define SWR_CAL_MAX_SLOPE_MW 65535      // steepest segment, its Q16 slope has to fit 32 bits
+
+struct CalPoint {
+    uint16_t adc;
+    uint32_t mw;
+};
+
+// Nominal square-law detector curve for 1 kW full scale. Replace it with
+// measured points from a calibration file for real readings.
+static constexpr CalPoint SWR_FWD_CAL[] = {
+    {    0,       0 }, {   40,      95 }, {   80,     382 }, {  160,    1527 },
+    {  320,    6107 }, {  640,   24426 }, {  960,   54959 }, { 1280,   97705 },
+    { 1920,  219836 }, { 2560,  390820 }, { 3200,  610656 }, { 3840,  879344 },
+    { 4095, 1000000 },
+};
+static constexpr CalPoint SWR_REF_CAL[] = {
+    {    0,       0 }, {   40,      95 }, {   80,     382 }, {  160,    1527 },
+    {  320,    6107 }, {  640,   24426 }, {  960,   54959 }, { 1280,   97705 },
+    { 1920,  219836 }, { 2560,  390820 }, { 3200,  610656 }, { 3840,  879344 },
+    { 4095, 1000000 },
+};
+static constexpr uint8_t SWR_FWD_CAL_POINTS = sizeof(SWR_FWD_CAL) / sizeof(SWR_FWD_CAL[0]);
+static constexpr uint8_t SWR_REF_CAL_POINTS = sizeof(SWR_REF_CAL) / sizeof(SWR_REF_CAL[0]);
+
+class PowerCurve {
+public:
+    // Copies the points, which must have strictly rising ADC counts and
+    // non-decreasing power, by less than SWR_CAL_MAX_SLOPE_MW per count.
+    // Returns false and keeps the old curve otherwise.
+    bool load(const CalPoint *points, uint8_t count);
+
+    uint32_t milliwatts(uint16_t adc) const;
+
+private:
+    CalPoint pts[SWR_CAL_MAX_POINTS];
+    uint32_t slope[SWR_CAL_MAX_POINTS];     // mW per count, Q16
+    uint8_t  n = 0;
+};
+
+struct SwrResult {
+    uint32_t fwdMw;
+    uint32_t refMw;
+    uint16_t swrQ8;             // SWR * 256, 0 when there is no forward power
+    uint16_t returnLossDb10;    // return loss in 0.1 dB
+};
+
+// log2(x) in Q8, 0 for x == 0
+int32_t log2Q8(uint32_t x);
+
+void computeSWR(const PowerCurve &fwd, const PowerCurve &ref, uint16_t fwdAdc, uint16_t refAdc, SwrResult &out);
+
+#endif /* SWR_CALC_H_ */
@@ -0,0 +1,122 @@
+#include "swr_capture.h"
+
+void SwrCapture::begin(const AdcSampler &sampler) {
+    adc = &sampler;
+}
+
+bool SwrCapture::configure(const CaptureConfig &config) {
+    if (config.channel >= ADC_CHANNELS || config.slope > CAPTURE_FALLING || config.mode > CAPTURE_AUTO) return false;
+    if (config.post == 0 || config.pre + config.post > CAPTURE_MAX_SAMPLES) return false;
+
+    portENTER_CRITICAL(&mux);
+    next = config;
+    portEXIT_CRITICAL(&mux);
+    pending.store(true, std::memory_order_release);
+    return true;
+}
+
+CaptureConfig SwrCapture::config() const {
+    portENTER_CRITICAL(&mux);
+    CaptureConfig c = next;
+    portEXIT_CRITICAL(&mux);
+    return c;
+}
+
+void SwrCapture::process(const AdcSample &sample) {
+    if (pending.load(std::memory_order_acquire)) {
+        pending.store(false, std::memory_order_relaxed);
+        portENTER_CRITICAL(&mux);
+        cfg = next;
+        portEXIT_CRITICAL(&mux);
+        triggered = false;
+        havePrev  = false;
+        isArmed.store(cfg.mode != CAPTURE_OFF, std::memory_order_release);
+    }
+    if (!isArmed.load(std::memory_order_relaxed)) return;
+
+    // the sample being processed gets ring index head(), everything before
+    // it is in the ring already
+    uint32_t index = adc->head();
+    if (triggered) {
+        if (index - trigIndex >= cfg.post) complete();
+        return;
+    }
+
+    uint16_t v = sample.ch[cfg.channel];
+    bool edge = havePrev && (cfg.slope == CAPTURE_RISING ? (prev < cfg.level && v >= cfg.level)
+                                                         : (prev > cfg.level && v <= cfg.level));
+    prev     = v;
+    havePrev = true;
+    if (!edge) return;
+
+    triggered = true;
+    trigIndex = index;
+    trigAt    = millis();
+    trigDir   = direction.load(std::memory_order_relaxed);
+}
+
+void SwrCapture::complete() {
+    uint32_t id = nextId++;
+    Slot &s = slots[id % CAPTURE_SLOTS];
+
+    s.id.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s.info.dir        = trigDir;
+    s.info.channel    = cfg.channel;
+    s.info.slope      = cfg.slope;
+    s.info.channels   = ADC_CHANNELS;
+    s.info.level      = cfg.level;
+    s.info.id         = id;
+    s.info.timestamp  = trigAt;
+    s.info.pre        = cfg.pre;
+    s.info.post       = cfg.post;
+    s.info.sampleRate = adc->sampleRate();
+
+    // the samples before the trigger may be fewer than pre right after boot
+    uint16_t n = 0;
+    for (uint32_t i = trigIndex - cfg.pre; i != trigIndex + cfg.post; i++) {
+        if (adc->raw(i, s.samples[n])) n++;
+    }
+    s.info.pre = cfg.pre - (cfg.pre + cfg.post - n);
+
+    s.id.store(id, std::memory_order_release);
+    latestId.store(id, std::memory_order_release);
+
+    triggered = false;
+    havePrev  = false;
+    if (cfg.mode == CAPTURE_SINGLE) isArmed.store(false, std::memory_order_release);
+}
+
+size_t SwrCapture::length(uint32_t id) const {
+    if (id == 0) return 0;
+    const Slot &s = slots[id % CAPTURE_SLOTS];
+    if (s.id.load(std::memory_order_acquire) != id) return 0;
+    size_t len = frameLength(s.info.pre + s.info.post);
+    return s.id.load(std::memory_order_acquire) == id ? len : 0;
+}
+
+size_t SwrCapture::encode(uint32_t id, uint8_t *buf, size_t len) const {
+    if (id == 0) return 0;
+    const Slot &s = slots[id % CAPTURE_SLOTS];
+    if (s.id.load(std::memory_order_acquire) != id) return 0;
+
+    CaptureFrame info = s.info;
+    uint16_t n = info.pre + info.post;
+    size_t total = frameLength(n);
+    if (len < total) return 0;
+
+    encodeCaptureHeader(info, buf, len);
+    uint8_t *p = buf + WS_CAPTURE_HEADER_LEN;
+    for (uint16_t i = 0; i < n; i++) {
+        for (uint8_t c = 0; c < ADC_CHANNELS; c++) {
+            uint16_t v = s.samples[i].ch[c];
+            *p++ = (uint8_t)v;
+            *p++ = (uint8_t)(v >> 8);
+        }
+    }
+
+    // the sampler task may have reused the slot while we copied
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return s.id.load(std::memory_order_relaxed) == id ? total : 0;
+}
@@ -0,0 +1,107 @@
+#ifndef SWR_CAPTURE_H_
+#define SWR_CAPTURE_H_
+
+#include <Arduino.h>
+#include <atomic>
+#include "adc_sampler.h"
+#include "ws_proto.h"
+
+// ----------------------------------------------------------------------------
+// Transient capture
+// ----------------------------------------------------------------------------
+//
+// Oscilloscope-style edge trigger on one raw ADC channel. process() runs in
+// the sampler task for every raw sample. While nothing triggers it costs one
+// compare. The sampler's raw ring is the pre/post-trigger buffer: once the
+// post-trigger samples have arrived, the whole window is copied out of the
+// ring into a capture slot, so pre + post must stay below ADC_RING_LEN.
+//
+// Captures are numbered from 1 and stamped with the direction that was active
+// at the trigger. The last CAPTURE_SLOTS are kept. Readers copy a capture out
+// with get(), which fails if the slot was reused during the copy.
+//
+// In CAPTURE_AUTO mode the trigger re-arms after each capture, in
+// CAPTURE_SINGLE it stays disarmed until configured again. A new config is
+// handed over to the sampler task, which applies it before its next sample
+// and drops a capture in progress.
+
+#define CAPTURE_SLOTS       4
+#define CAPTURE_MAX_SAMPLES (ADC_RING_LEN - 1)
+#define CAPTURE_PRE         127
+#define CAPTURE_POST        384
+
+#define CAPTURE_RISING      0
+#define CAPTURE_FALLING     1
+
+#define CAPTURE_OFF         0
+#define CAPTURE_SINGLE      1
+#define CAPTURE_AUTO        2
+
+struct CaptureConfig {
+    uint8_t  mode;
+    uint8_t  channel;       // ADC_CH_FWD / ADC_CH_REF
+    uint8_t  slope;
+    uint16_t level;         // raw ADC counts
+    uint16_t pre;
+    uint16_t post;
+};
+
+class SwrCapture {
+public:
+    void begin(const AdcSampler &sampler);
+
+    // Returns false if the config is invalid
+    bool configure(const CaptureConfig &config);
+    CaptureConfig config() const;
+    bool armed() const { return isArmed.load(std::memory_order_acquire); }
+
+    void setDirection(uint8_t dir) { direction.store(dir, std::memory_order_relaxed); }
+
+    // One raw sample, from the sampler task before it is buffered
+    void process(const AdcSample &sample);
+
+    // id of the newest complete capture, 0 = none yet
+    uint32_t latest() const { return latestId.load(std::memory_order_acquire); }
+
+    // Encodes capture id as a WS_FRAME_CAPTURE frame into buf. Returns the
+    // length, 0 if the capture is gone or buf is too small.
+    size_t encode(uint32_t id, uint8_t *buf, size_t len) const;
+    // frame length of capture id, 0 if it is gone
+    size_t length(uint32_t id) const;
+    static size_t frameLength(uint16_t samples) {
+        return WS_CAPTURE_HEADER_LEN + (size_t)samples * ADC_CHANNELS * 2;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> id{0};    // 0 while being written
+        CaptureFrame info;
+        AdcSample    samples[CAPTURE_MAX_SAMPLES];
+    };
+
+    void complete();
+
+    const AdcSampler *adc = NULL;
+    std::atomic<uint8_t> direction{0};
+
+    // requested config, taken over by the sampler task when pending is set
+    mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    CaptureConfig     next = { CAPTURE_OFF, ADC_CH_REF, CAPTURE_RISING, 2048, CAPTURE_PRE, CAPTURE_POST };
+    std::atomic<bool> pending{false};
+    std::atomic<bool> isArmed{false};
+
+    // sampler task state
+    CaptureConfig cfg = {};
+    bool     triggered = false;
+    bool     havePrev  = false;
+    uint16_t prev      = 0;
+    uint32_t trigIndex = 0;
+    uint32_t trigAt    = 0;
+    uint8_t  trigDir   = 0;
+    uint32_t nextId    = 1;
+
+    std::atomic<uint32_t> latestId{0};
+    Slot slots[CAPTURE_SLOTS];
+};
+
+#endif /* SWR_CAPTURE_H_ */
@@ -0,0 +1,171 @@
+#include "swr_history.h"
+
+static const uint32_t TIER_RECORDS[HIST_TIERS] = { 60000, 86400, 10080, 504 };
+static const uint32_t TIER_PERIOD_MS[HIST_TIERS] = { 0, 1000UL, 60000UL, 3600000UL };
+static const char *const TIER_NAMES[HIST_TIERS] = { "raw", "1s", "1m", "1h" };
+
+bool SwrHistory::begin() {
+    bool psram = psramFound();
+    for (uint8_t i = 0; i < HIST_TIERS; i++) {
+        Tier &t = tiers[i];
+        t.cap      = psram ? TIER_RECORDS[i] : TIER_RECORDS[i] / HIST_NO_PSRAM_DIV;
+        t.periodMs = TIER_PERIOD_MS[i];
+        size_t size = t.cap * sizeof(HistRecord);
+        t.buf = (HistRecord *)(psram ? ps_malloc(size) : malloc(size));
+        if (t.buf == NULL) {
+            t.cap = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+int8_t SwrHistory::tierByName(const char *name) {
+    for (uint8_t i = 0; i < HIST_TIERS; i++) {
+        if (strcmp(name, TIER_NAMES[i]) == 0) return i;
+    }
+    return -1;
+}
+
+void SwrHistory::add(const SwrResult &m, uint8_t dir, uint32_t now) {
+    HistRecord r;
+    r.t      = now;
+    r.fwdMw  = m.fwdMw;
+    r.swrMin = m.swrQ8;
+    r.swrAvg = m.swrQ8;
+    r.swrMax = m.swrQ8;
+    r.dir    = dir;
+    r.rfPct  = m.swrQ8 ? 100 : 0;
+    push(HIST_RAW, r);
+}
+
+void SwrHistory::push(uint8_t tier, const HistRecord &r) {
+    Tier &t = tiers[tier];
+    if (t.cap) {
+        uint32_t h = t.head.load(std::memory_order_relaxed);
+        t.buf[h % t.cap] = r;
+        t.head.store(h + 1, std::memory_order_release);
+    }
+    if (tier + 1 < HIST_TIERS) accumulate(tier + 1, r);
+}
+
+void SwrHistory::accumulate(uint8_t tier, const HistRecord &r) {
+    Tier  &t = tiers[tier];
+    Accum &a = t.acc;
+
+    if (a.n && (r.t - a.start >= t.periodMs || r.dir != a.dir)) {
+        HistRecord out;
+        out.t      = a.start;
+        out.fwdMw  = (uint32_t)(a.fwdSum / a.n);
+        out.swrMin = a.swrWeight ? a.swrMin : 0;
+        out.swrAvg = a.swrWeight ? (uint16_t)(a.swrSum / a.swrWeight) : 0;
+        out.swrMax = a.swrMax;
+        out.dir    = a.dir;
+        out.rfPct  = (uint8_t)(a.rfSum / a.n);
+        a = {};
+        push(tier, out);
+    }
+
+    if (a.n == 0) {
+        a.start  = r.t;
+        a.dir    = r.dir;
+        a.swrMin = 0xffff;
+    }
+    a.n++;
+    a.fwdSum += r.fwdMw;
+    a.rfSum  += r.rfPct;
+    if (r.rfPct) {
+        a.swrSum    += (uint32_t)r.swrAvg * r.rfPct;
+        a.swrWeight += r.rfPct;
+        if (r.swrMin < a.swrMin) a.swrMin = r.swrMin;
+        if (r.swrMax > a.swrMax) a.swrMax = r.swrMax;
+    }
+}
+
+uint32_t SwrHistory::oldest(uint8_t tier) const {
+    uint32_t h = head(tier);
+    // keep one slot clear of the writer, see read()
+    uint32_t keep = tiers[tier].cap ? tiers[tier].cap - 1 : 0;
+    return h > keep ? h - keep : 0;
+}
+
+bool SwrHistory::read(uint8_t tier, uint32_t index, HistRecord &out) const {
+    const Tier &t = tiers[tier];
+    // the writer fills slot head % cap next, which is index % cap at age cap
+    uint32_t age = head(tier) - index;
+    if (age == 0 || age >= t.cap) return false;
+    out = t.buf[index % t.cap];
+    return head(tier) - index < t.cap;
+}
+
+HistCursor SwrHistory::query(uint8_t tier, uint32_t from, uint32_t to, uint8_t dir, bool csv) const {
+    HistCursor c = {};
+    c.tier = tier;
+    c.csv  = csv;
+    c.dir  = dir;
+    c.to   = to;
+
+    // binary search for the first record at or after 'from'
+    uint32_t lo = oldest(tier), hi = head(tier);
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        HistRecord r;
+        if (!read(tier, mid, r)) {
+            lo = mid + 1;           // overwritten meanwhile, it was older anyway
+        } else if ((int32_t)(r.t - from) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    c.next = lo;
+    return c;
+}
+
+size_t SwrHistory::exportChunk(HistCursor &c, uint8_t *buf, size_t maxLen) const {
+    size_t len = 0;
+
+    if (!c.header) {
+        if (c.csv) {
+            static const char HEADER[] = "t_ms,dir,fwd_mw,rf_pct,swr_min,swr_avg,swr_max\n";
+            if (maxLen < sizeof(HEADER) - 1) return 0;
+            memcpy(buf, HEADER, sizeof(HEADER) - 1);
+            len = sizeof(HEADER) - 1;
+        } else {
+            if (maxLen < 4) return 0;
+            buf[0] = 'H';
+            buf[1] = HIST_FORMAT_VERSION;
+            buf[2] = c.tier;
+            buf[3] = sizeof(HistRecord);
+            len = 4;
+        }
+        c.header = true;
+    }
+
+    size_t need = c.csv ? HIST_CSV_LINE_MAX : sizeof(HistRecord);
+    while (!c.done && maxLen - len >= need) {
+        // a slow download may have been overtaken by the writer
+        uint32_t first = oldest(c.tier);
+        if ((int32_t)(c.next - first) < 0) c.next = first;
+
+        HistRecord r;
+        if (!read(c.tier, c.next, r) || (int32_t)(r.t - c.to) > 0) {
+            c.done = true;
+            break;
+        }
+        c.next++;
+        if (c.dir && r.dir != c.dir) continue;
+
+        if (c.csv) {
+            len += snprintf((char *)buf + len, maxLen - len, "%lu,%u,%lu,%u,%u.%02u,%u.%02u,%u.%02u\n",
+                            (unsigned long)r.t, r.dir, (unsigned long)r.fwdMw, r.rfPct,
+                            r.swrMin >> 8, ((r.swrMin & 0xff) * 100) >> 8,
+                            r.swrAvg >> 8, ((r.swrAvg & 0xff) * 100) >> 8,
+                            r.swrMax >> 8, ((r.swrMax & 0xff) * 100) >> 8);
+        } else {
+            memcpy(buf + len, &r, sizeof(r));
+            len += sizeof(r);
+        }
+    }
+    return len;
+}
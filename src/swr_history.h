@@ -0,0 +1,121 @@
+#ifndef SWR_HISTORY_H_
+#define SWR_HISTORY_H_
+
+#include <Arduino.h>
+#include <atomic>
+#include "swr_calc.h"
+
+// ----------------------------------------------------------------------------
+// SWR history
+// ----------------------------------------------------------------------------
+//
+// Four fixed-size rings of 16-byte records, allocated in PSRAM:
+//
+//   tier  period          records   span
+//   raw   every reading   60000     10 min at 100 Hz
+//   1s    1 s             86400     24 h
+//   1m    1 min           10080     7 days
+//   1h    1 h             504       21 days
+//
+// loop() feeds every published reading through add(). Each tier aggregates
+// the records of the one below into min/avg/max and closes its period early
+// when the direction changes, so every record belongs to one antenna. The
+// SWR of a record only covers the time with RF, rfPct says how much of the
+// period that was. Averages of the upper tiers are averages of the lower
+// tier records.
+//
+// loop() is the only writer. Readers (the HTTP export) follow a ring with an
+// index and recheck it after copying a record, like AdcSampler::raw(), so a
+// record overwritten while it was read is skipped instead of returned torn.
+// Without PSRAM the rings shrink to HIST_NO_PSRAM_DIV of their size.
+//
+// Timestamps are millis(). They are compared as signed differences, so ranges
+// stay valid across the 49 day wrap as long as they span less than 24 days,
+// which is more than any tier holds.
+
+#define HIST_TIERS          4
+#define HIST_RAW            0
+#define HIST_1S             1
+#define HIST_1M             2
+#define HIST_1H             3
+
+#define HIST_NO_PSRAM_DIV   64
+
+#define HIST_FORMAT_VERSION 1
+#define HIST_CSV_LINE_MAX   48      // longest CSV line, newline included
+
+struct HistRecord {
+    uint32_t t;         // millis() at the start of the period
+    uint32_t fwdMw;     // average forward power
+    uint16_t swrMin;    // SWR * 256 while RF was present, 0 = no RF
+    uint16_t swrAvg;
+    uint16_t swrMax;
+    uint8_t  dir;       // actual_dir during the period
+    uint8_t  rfPct;     // share of the period with RF, 0..100
+};
+static_assert(sizeof(HistRecord) == 16, "HistRecord is exported as is");
+
+// Export state of one download, see exportChunk()
+struct HistCursor {
+    uint8_t  tier;
+    bool     csv;
+    uint8_t  dir;       // 0 = all directions
+    bool     header;    // header written
+    bool     done;
+    uint32_t next;      // ring index of the next record
+    uint32_t to;        // last timestamp to export
+};
+
+class SwrHistory {
+public:
+    bool begin();
+
+    // A new reading, from loop()
+    void add(const SwrResult &m, uint8_t dir, uint32_t now);
+
+    uint32_t capacity(uint8_t tier) const { return tiers[tier].cap; }
+    uint32_t head(uint8_t tier) const { return tiers[tier].head.load(std::memory_order_acquire); }
+    uint32_t oldest(uint8_t tier) const;
+    bool read(uint8_t tier, uint32_t index, HistRecord &out) const;
+
+    // Cursor over [from, to] of a tier
+    HistCursor query(uint8_t tier, uint32_t from, uint32_t to, uint8_t dir, bool csv) const;
+
+    // Writes the next whole records (binary) or lines (CSV) into buf and
+    // returns the byte count. Returns 0 with cursor.done set at the end, and
+    // 0 without it when maxLen cannot hold a single record or line.
+    //
+    // The binary stream starts with a 4-byte header: 'H', HIST_FORMAT_VERSION,
+    // tier, sizeof(HistRecord), followed by the little-endian records.
+    size_t exportChunk(HistCursor &cursor, uint8_t *buf, size_t maxLen) const;
+
+    static int8_t tierByName(const char *name);
+
+private:
+    struct Accum {
+        uint32_t start;
+        uint64_t fwdSum;
+        uint32_t swrSum;    // swrAvg weighted by rfPct
+        uint32_t swrWeight;
+        uint32_t rfSum;
+        uint32_t n;
+        uint16_t swrMin;
+        uint16_t swrMax;
+        uint8_t  dir;
+    };
+
+    struct Tier {
+        HistRecord *buf = NULL;
+        uint32_t    cap = 0;
+        uint32_t    periodMs = 0;
+        std::atomic<uint32_t> head{0};
+        Accum       acc = {};
+    };
+
+    void push(uint8_t tier, const HistRecord &r);
+    void accumulate(uint8_t tier, const HistRecord &r);
+
+    Tier tiers[HIST_TIERS];
+};
+
+#endif /* SWR_HISTORY_H_ */
@@ -0,0 +1,68 @@
+#include "swr_interlock.h"
+#include "adc_pipeline.h"
+
+void SwrInterlock::begin(const PowerCurve &fwd, const PowerCurve &ref, uint32_t sampleHz,
+                         SwrTripAction action, void *ctx) {
+    fwdCurve    = &fwd;
+    refCurve    = &ref;
+    act         = action;
+    actCtx      = ctx;
+    holdSamples = (uint32_t)SWR_RF_HOLD_MS * sampleHz / 1000;
+    setLimits(SWR_TRIP_Q8, SWR_TRIP_MIN_MW, SWR_RF_MW);
+}
+
+void SwrInterlock::setLimits(uint16_t tripSwrQ8, uint32_t minFwdMw, uint32_t rfMw) {
+    if (tripSwrQ8 <= SWR_Q8_MIN) tripSwrQ8 = SWR_Q8_MIN + 1;
+    // |gamma| = (SWR - 1) / (SWR + 1), Pr/Pf = gamma^2
+    uint32_t gamma = ((uint32_t)(tripSwrQ8 - SWR_Q8_MIN) << 16) / (tripSwrQ8 + SWR_Q8_MIN);
+    ratioQ16 = (uint32_t)(((uint64_t)gamma * gamma) >> 16);
+    minFwd   = minFwdMw;
+    rfLevel  = rfMw;
+}
+
+void SwrInterlock::process(const uint16_t *adc, uint32_t sampledAt) {
+    uint32_t f = fwdCurve->milliwatts(adc[ADC_CH_FWD]);
+
+    if (f >= rfLevel) {
+        rfHold = holdSamples ? holdSamples : 1;
+    } else if (rfHold) {
+        rfHold--;
+    }
+    rf.store(rfHold != 0, std::memory_order_release);
+
+    if (f < minFwd || latched.load(std::memory_order_relaxed)) {
+        over = 0;
+        return;
+    }
+
+    uint32_t r = refCurve->milliwatts(adc[ADC_CH_REF]);
+    if (((uint64_t)r << 16) >= (uint64_t)f * ratioQ16) {
+        if (over == 0) firstOverAt = sampledAt;
+        if (++over >= SWR_TRIP_SAMPLES) trip(SWR_TRIP_SWR, firstOverAt);
+    } else {
+        over = 0;
+    }
+}
+
+void IRAM_ATTR SwrInterlock::trip(uint8_t why, uint32_t detectedAt) {
+    // only the first of the sampler task and the comparator interrupt acts
+    bool expected = false;
+    if (!latched.compare_exchange_strong(expected, true)) return;
+
+    if (act) act(true, actCtx);
+
+    uint32_t latency = micros() - detectedAt;
+    tripCause     = why;
+    lastLatencyUs = latency;
+    if (latency > maxLatencyUs) maxLatencyUs = latency;
+    tripCount++;
+}
+
+bool SwrInterlock::clear() {
+    if (rfPresent()) return false;
+    if (!tripped()) return true;
+    if (act) act(false, actCtx);
+    tripCause = SWR_TRIP_NONE;
+    latched.store(false, std::memory_order_release);
+    return true;
+}
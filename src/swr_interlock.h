@@ -0,0 +1,90 @@
+#ifndef SWR_INTERLOCK_H_
+#define SWR_INTERLOCK_H_
+
+#include <Arduino.h>
+#include <atomic>
+#include "swr_calc.h"
+
+// ----------------------------------------------------------------------------
+// High-SWR interlock
+// ----------------------------------------------------------------------------
+//
+// process() runs in the ADC sampler task for every raw sample, so a trip does
+// not wait for loop(). The reflected/forward power ratio is compared against
+// the limit as Pr * 2^16 >= Pf * ratio, so the check is two curve lookups and
+// one multiply. SWR_TRIP_SAMPLES consecutive samples over the limit trip the
+// interlock. At the default rate the fault is asserted within
+// SWR_TRIP_SAMPLES / ADC_SAMPLE_HZ (1 ms) of the mismatch, plus the sampler
+// task wake-up. An external comparator can call trip() directly from its
+// interrupt.
+//
+// A trip latches: the trip action runs once (e.g. to inhibit the amplifier)
+// and the interlock stays tripped until clear() is accepted, which it is only
+// without RF. RF counts as present while forward power is above the RF level
+// and for SWR_RF_HOLD_MS after it, so relays are not switched in the gaps of
+// keyed or SSB transmissions.
+//
+// The trip latency is measured from the first over-limit sample (or the
+// comparator edge) to the return of the trip action.
+
+#define SWR_TRIP_Q8         (3 * 256)   // trip above SWR 3.0
+#define SWR_TRIP_MIN_MW     1000        // SWR is not checked below this forward power
+#define SWR_TRIP_SAMPLES    2           // consecutive over-limit samples to trip
+#define SWR_RF_MW           500         // forward power above which RF is present
+#define SWR_RF_HOLD_MS      250
+
+#define SWR_TRIP_NONE       0
+#define SWR_TRIP_SWR        1           // measured SWR over the limit
+#define SWR_TRIP_COMPARATOR 2           // external comparator
+
+// Called with true from the tripping context when the interlock trips, and
+// with false from clear() just before it is released.
+typedef void (*SwrTripAction)(bool tripped, void *ctx);
+
+class SwrInterlock {
+public:
+    void begin(const PowerCurve &fwd, const PowerCurve &ref, uint32_t sampleHz,
+               SwrTripAction action = NULL, void *ctx = NULL);
+    void setLimits(uint16_t tripSwrQ8, uint32_t minFwdMw, uint32_t rfMw);
+
+    // One raw sample pair (ADC_CH_FWD / ADC_CH_REF), sampledAt in micros()
+    void process(const uint16_t *adc, uint32_t sampledAt);
+
+    // Trips immediately, safe to call from an interrupt
+    void trip(uint8_t cause, uint32_t detectedAt);
+
+    // Releases the latch, refused (false) while RF is present
+    bool clear();
+
+    bool     tripped()   const { return latched.load(std::memory_order_acquire); }
+    bool     rfPresent() const { return rf.load(std::memory_order_acquire); }
+    uint8_t  cause()     const { return tripCause; }
+    uint32_t trips()     const { return tripCount; }
+    uint32_t lastLatency() const { return lastLatencyUs; }
+    uint32_t maxLatency()  const { return maxLatencyUs; }
+
+private:
+    const PowerCurve *fwdCurve = NULL;
+    const PowerCurve *refCurve = NULL;
+    SwrTripAction act = NULL;
+    void    *actCtx   = NULL;
+
+    uint32_t ratioQ16   = 0;            // (Pr/Pf) limit, Q16
+    uint32_t minFwd     = SWR_TRIP_MIN_MW;
+    uint32_t rfLevel    = SWR_RF_MW;
+    uint32_t holdSamples = 0;
+
+    // sampler task state
+    uint32_t rfHold      = 0;
+    uint8_t  over        = 0;
+    uint32_t firstOverAt = 0;
+
+    std::atomic<bool> latched{false};
+    std::atomic<bool> rf{false};
+    volatile uint8_t  tripCause = SWR_TRIP_NONE;
+    volatile uint32_t tripCount = 0;
+    volatile uint32_t lastLatencyUs = 0;
+    volatile uint32_t maxLatencyUs  = 0;
+};
+
+#endif /* SWR_INTERLOCK_H_ */
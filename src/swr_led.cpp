@@ -1,30 +1,126 @@
-
 #include <Arduino.h> //Denne inkluderer arduino biblioteket
+#include <soc/gpio_reg.h>
 #include "swr_led.h" //Denne inkluderer header fila til swr_led
 
+// LED n lyser når verdien er over terskelen. LEDene er aktivt lave.
+static const struct { uint8_t pin; uint8_t threshold; } SWR_LEDS[] = {
+    { SWRLED_01, 0 },
+    { SWRLED_04, 3 },
+    { SWRLED_05, 4 },
+    { SWRLED_06, 5 },
+    { SWRLED_07, 6 },
+    { SWRLED_08, 7 },
+    { SWRLED_09, 8 },
+    { SWRLED_10, 9 },
+};
+static const uint8_t SWR_LED_COUNT = sizeof(SWR_LEDS) / sizeof(SWR_LEDS[0]);
+
+// Masker for GPIO 0..31 og GPIO 32 og oppover
+static uint32_t loMask[SWR_LED_COUNT];
+static uint32_t hiMask[SWR_LED_COUNT];
+
+static uint8_t  ledsOn    = 0;      // bit n set = LED n lit
+static uint32_t writes    = 0;
+
+static uint8_t  mode      = SWR_MODE_BAR;
+static uint16_t holdMs    = 1000;
+static uint16_t decayMs   = 100;
+static uint16_t hysteresis = 0;
+
+static uint8_t  level     = 0;      // level after hysteresis
+static uint8_t  shown     = 0;      // level after peak hold / decay
+static uint32_t shownAt   = 0;
+
+// Skriver bare LEDene som har endret seg, alle på en gang
+static void writeLeds(uint8_t on, uint8_t changed) {
+    uint32_t setLo = 0, setHi = 0, clrLo = 0, clrHi = 0;
+    for (uint8_t i = 0; i < SWR_LED_COUNT; i++) {
+        if (!(changed & (1 << i))) continue;
+        if (on & (1 << i)) { clrLo |= loMask[i]; clrHi |= hiMask[i]; }   // lit = LOW
+        else               { setLo |= loMask[i]; setHi |= hiMask[i]; }
+    }
+    if (setLo) { REG_WRITE(GPIO_OUT_W1TS_REG,  setLo); writes++; }
+    if (clrLo) { REG_WRITE(GPIO_OUT_W1TC_REG,  clrLo); writes++; }
+    if (setHi) { REG_WRITE(GPIO_OUT1_W1TS_REG, setHi); writes++; }
+    if (clrHi) { REG_WRITE(GPIO_OUT1_W1TC_REG, clrHi); writes++; }
+    ledsOn = on;
+}
+
 void initSWRDisplay() { //Denne setter SWR displayet til output
-    pinMode(SWRLED_01,      OUTPUT);
-    //pinMode(SWRLED_02,      OUTPUT);
-    //pinMode(SWRLED_03,      OUTPUT); //Denne inputen er reservert til knapp
-    pinMode(SWRLED_04,      OUTPUT);
-    pinMode(SWRLED_05,      OUTPUT);
-    pinMode(SWRLED_06,      OUTPUT);
-    pinMode(SWRLED_07,      OUTPUT);
-    pinMode(SWRLED_08,      OUTPUT);
-    pinMode(SWRLED_09,      OUTPUT);
-    pinMode(SWRLED_10,      OUTPUT);    
+    for (uint8_t i = 0; i < SWR_LED_COUNT; i++) {
+        uint8_t pin = SWR_LEDS[i].pin;
+        loMask[i] = pin < 32 ? (1UL << pin) : 0;
+        hiMask[i] = pin < 32 ? 0 : (1UL << (pin - 32));
+        pinMode(pin, OUTPUT);
+    }
+    // start med alle LEDene av
+    writeLeds(0, 0xFF);
 }
 
 //hvis over  resistans skal led 1 lyse
 void setSWRLeds(uint8_t value){
-    if (value > 0) { digitalWrite(SWRLED_01, LOW);} else { digitalWrite(SWRLED_01, HIGH);}
-    //if (value > 1) { digitalWrite(SWRLED_02, LOW);} else { digitalWrite(SWRLED_02, HIGH);}
-    //if (value > 2) { digitalWrite(SWRLED_03, LOW);} else { digitalWrite(SWRLED_03, HIGH);}
-    if (value > 3) { digitalWrite(SWRLED_04, LOW);} else { digitalWrite(SWRLED_04, HIGH);}
-    if (value > 4) { digitalWrite(SWRLED_05, LOW);} else { digitalWrite(SWRLED_05, HIGH);}
-    if (value > 5) { digitalWrite(SWRLED_06, LOW);} else { digitalWrite(SWRLED_06, HIGH);}
-    if (value > 6) { digitalWrite(SWRLED_07, LOW);} else { digitalWrite(SWRLED_07, HIGH);}
-    if (value > 7) { digitalWrite(SWRLED_08, LOW);} else { digitalWrite(SWRLED_08, HIGH);}
-    if (value > 8) { digitalWrite(SWRLED_09, LOW);} else { digitalWrite(SWRLED_09, HIGH);}
-    if (value > 9) { digitalWrite(SWRLED_10, LOW);} else { digitalWrite(SWRLED_10, HIGH);}
-}
\ No newline at end of file
+    uint8_t on = 0;
+    for (uint8_t i = 0; i < SWR_LED_COUNT; i++) {
+        if (value > SWR_LEDS[i].threshold) on |= 1 << i;
+    }
+    uint8_t changed = on ^ ledsOn;
+    if (changed) writeLeds(on, changed);
+}
+
+// Raw reading where level k starts
+static uint16_t levelStart(uint8_t k) {
+    return (uint16_t)(((uint32_t)k * SWR_RAW_MAX + SWR_LEVELS - 1) / SWR_LEVELS);
+}
+
+static uint8_t toLevel(int32_t raw) {
+    if (raw < 0) raw = 0;
+    if (raw > SWR_RAW_MAX) raw = SWR_RAW_MAX;
+    return (uint8_t)((uint32_t)raw * SWR_LEVELS / SWR_RAW_MAX);
+}
+
+void updateSWRDisplay(uint16_t raw) {
+    // Hysterese: nivået endres først når målingen er godt forbi grensen
+    uint8_t candidate = toLevel(raw);
+    if (candidate > level && raw >= levelStart(level + 1) + hysteresis) {
+        level = toLevel((int32_t)raw - hysteresis);
+    } else if (candidate < level && (uint32_t)raw + hysteresis < levelStart(level)) {
+        level = toLevel((int32_t)raw + hysteresis);
+    }
+
+    uint32_t now = millis();
+    switch (mode) {
+        case SWR_MODE_PEAK_HOLD:
+            if (level >= shown || now - shownAt >= holdMs) {
+                shown   = level;
+                shownAt = now;
+            }
+            break;
+        case SWR_MODE_DECAY:
+            if (level >= shown) {
+                shown   = level;
+                shownAt = now;
+            } else if (now - shownAt >= decayMs) {
+                shown--;
+                shownAt = now;
+            }
+            break;
+        default:
+            shown = level;
+            break;
+    }
+    setSWRLeds(shown);
+}
+
+void setSWRDisplayMode(uint8_t m, uint16_t hold, uint16_t decay) {
+    mode    = m;
+    holdMs  = hold;
+    decayMs = decay;
+}
+
+void setSWRHysteresis(uint16_t rawCounts) {
+    hysteresis = rawCounts;
+}
+
+uint32_t swrLedWrites() {
+    return writes;
+}
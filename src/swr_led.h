@@ -1,7 +1,8 @@
-
 #ifndef SWRLED_H_
 #define SWRLED_H_
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -17,12 +18,30 @@ extern "C" {
 #define SWRLED_09 40
 #define SWRLED_10 41
 
+#define SWR_LEVELS      10      // full scale of the bar graph
+#define SWR_RAW_MAX     4095    // full scale of the raw reading
+
+// Visningsmodus for søylen
+#define SWR_MODE_BAR        0   // follows the level directly
+#define SWR_MODE_PEAK_HOLD  1   // holds the highest level for the hold time
+#define SWR_MODE_DECAY      2   // rises at once, falls one LED per decay step
 
 void initSWRDisplay();
+
+// Shows value (0..SWR_LEVELS) as is, only LEDs that change are written.
 void setSWRLeds(uint8_t value);
 
+// Scales a raw reading with hysteresis, applies the display mode and shows it.
+void updateSWRDisplay(uint16_t raw);
+
+void setSWRDisplayMode(uint8_t mode, uint16_t holdMs, uint16_t decayMs);
+void setSWRHysteresis(uint16_t rawCounts);
+
+// number of GPIO register writes so far
+uint32_t swrLedWrites();
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif /* ROTSWITCH_H_ */
+#endif /* SWRLED_H_ */
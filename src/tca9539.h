@@ -4,6 +4,7 @@
 
 #include <Arduino.h>
 #include <Wire.h>
+#include "i2c_write_read.h"
 
 namespace arduino
 {
@@ -12,9 +13,18 @@ namespace arduino
     {
         uint8_t I2C_ADDR = 0x74;
 
+        // bounded retries for the synchronous accessors, backoff doubles
+        static const uint8_t RETRIES    = 3;
+        static const uint8_t BACKOFF_MS = 1;
+
         WireType* wire;
         uint8_t sts;
 
+        // Shadow copies of the OUTPUT, POLARITY and CONFIG registers, indexed
+        // by Reg. Bit n of shadowValid is set when shadow[n] matches the device.
+        uint8_t shadow[8];
+        uint8_t shadowValid = 0;
+
     public:
 
         enum class Port { PORT1 = 0, PORT2 = 1 };
@@ -133,8 +143,45 @@ namespace arduino
             }
         }
 
+        // 16-bit access to both ports, PORT1 in the low byte and PORT2 in the
+        // high byte. The TCA9539 toggles between the two registers of a pair
+        // on multi-byte transfers, so each call is a single bus transaction
+        // and both ports change at the same moment.
+        uint16_t input16() {
+            uint8_t data[2] = { 0, 0 };
+            readBytes(I2C_ADDR, (uint8_t)Reg::INPUT_PORT1, 2, data);
+            return data[0] | (data[1] << 8);
+        }
+
+        bool output16(const uint16_t state) { return writeWord(I2C_ADDR, (uint8_t)Reg::OUTPUT_PORT1, state); }
+        uint16_t output16() { return readWord(I2C_ADDR, (uint8_t)Reg::OUTPUT_PORT1); }
+
+        // bit set = inverted input
+        bool polarity16(const uint16_t pol) { return writeWord(I2C_ADDR, (uint8_t)Reg::POLARITY1, pol); }
+        uint16_t polarity16() { return readWord(I2C_ADDR, (uint8_t)Reg::POLARITY1); }
+
+        // bit set = input, bit clear = output
+        bool config16(const uint16_t cfg) { return writeWord(I2C_ADDR, (uint8_t)Reg::CONFIG1, cfg); }
+        uint16_t config16() { return readWord(I2C_ADDR, (uint8_t)Reg::CONFIG1); }
+
         uint8_t status() const { return sts; }
 
+        // Reloads all cached registers from the device, e.g. after a bus error
+        // or an expander reset. Returns false if any read failed.
+        bool sync() {
+            shadowValid = 0;
+            bool ok = true;
+            for (uint8_t reg = (uint8_t)Reg::OUTPUT_PORT1; reg <= (uint8_t)Reg::CONFIG1; reg += 2) {
+                uint16_t data;
+                ok = readCached16(I2C_ADDR, reg, data) && ok;
+            }
+            return ok;
+        }
+
+        // Drops the cache, the next access to each register goes to the bus.
+        void invalidate() { shadowValid = 0; }
+
+
     private:
 
         uint8_t readBit(uint8_t dev, uint8_t reg, uint8_t bit)
@@ -144,27 +191,92 @@ namespace arduino
             return b;
         }
 
+        static bool cacheable(uint8_t reg) { return reg >= (uint8_t)Reg::OUTPUT_PORT1; }
+
+        // Whether every register of a write already holds its data.
+        bool cached(uint8_t reg, uint8_t size, const uint8_t *data) const
+        {
+            for (uint8_t i = 0; i < size; i++) {
+                uint8_t r = (reg & ~1) | ((reg + i) & 1);
+                if (!cacheable(r) || !(shadowValid & (1 << r)) || shadow[r] != data[i]) return false;
+            }
+            return true;
+        }
+
+        // Reads one register, served from the shadow for cacheable registers.
+        bool readCached(uint8_t dev, uint8_t reg, uint8_t &data)
+        {
+            if (cacheable(reg) && (shadowValid & (1 << reg))) {
+                data = shadow[reg];
+                return true;
+            }
+            data = 0;
+            if (readBytes(dev, reg, 1, &data) != 1) return false;
+            if (cacheable(reg)) {
+                shadow[reg] = data;
+                shadowValid |= (1 << reg);
+            }
+            return true;
+        }
+
+        // Same for a register pair, reg must be the first of the pair.
+        bool readCached16(uint8_t dev, uint8_t reg, uint16_t &data)
+        {
+            uint8_t pair = 3 << reg;
+            if (cacheable(reg) && (shadowValid & pair) == pair) {
+                data = shadow[reg] | (shadow[reg + 1] << 8);
+                return true;
+            }
+            uint8_t b[2] = { 0, 0 };
+            data = 0;
+            if (readBytes(dev, reg, 2, b) != 2) return false;
+            if (cacheable(reg)) {
+                shadow[reg]     = b[0];
+                shadow[reg + 1] = b[1];
+                shadowValid |= pair;
+            }
+            data = b[0] | (b[1] << 8);
+            return true;
+        }
+
         uint8_t readByte(uint8_t dev, uint8_t reg)
         {
             uint8_t data;
-            readBytes(dev, reg, 1, &data);
+            readCached(dev, reg, data);
             return data;
         }
 
+        uint16_t readWord(uint8_t dev, uint8_t reg)
+        {
+            uint16_t data;
+            readCached16(dev, reg, data);
+            return data;
+        }
+
+        // Returns the number of bytes read, which is less than size if the
+        // transfer still failed after all retries.
         int8_t readBytes(uint8_t dev, uint8_t reg, uint8_t size, uint8_t *data)
         {
-            wire->beginTransmission(dev);
-            wire->write(reg);
-            wire->endTransmission();
-            wire->requestFrom(dev, size);
             int8_t count = 0;
-            while (wire->available()) data[count++] = wire->read();
+            for (uint8_t attempt = 0; ; attempt++) {
+                // register pointer write and read in one repeated start transfer
+                sts   = i2cWriteRead(*wire, dev, &reg, 1, data, size);
+                count = (sts == 0) ? size : 0;
+                if (count == size || attempt >= RETRIES) break;
+                delay(BACKOFF_MS << attempt);
+            }
+            if (count != size)
+            {
+                Serial.print("I2C READ ERROR : ");
+                Serial.println(sts);
+            }
             return count;
         }
 
         bool writeBit(uint8_t dev, uint8_t reg, uint8_t bit, uint8_t data)
         {
-            uint8_t b = readByte(dev, reg);
+            uint8_t b;
+            if (!readCached(dev, reg, b)) return false;
             b = (data != 0) ? (b | (1 << bit)) : (b & ~(1 << bit));
             return writeByte(dev, reg, b);
         }
@@ -174,18 +286,46 @@ namespace arduino
             return writeBytes(dev, reg, 1, &data);
         }
 
+        bool writeWord(uint8_t dev, uint8_t reg, uint16_t data)
+        {
+            uint8_t b[2] = { (uint8_t)data, (uint8_t)(data >> 8) };
+            return writeBytes(dev, reg, 2, b);
+        }
+
+        // Returns true without a transaction when the shadow already holds
+        // data, call invalidate() first to force the write.
         bool writeBytes(uint8_t dev, uint8_t reg, uint8_t size, uint8_t* data)
         {
-            wire->beginTransmission(dev);
-            wire->write(reg);
-            for (uint8_t i = 0; i < size; i++)
-                wire->write(data[i]);
-            sts = wire->endTransmission();
+            if (cached(reg, size, data)) {
+                sts = 0;
+                return true;
+            }
+            for (uint8_t attempt = 0; ; attempt++) {
+                wire->beginTransmission(dev);
+                wire->write(reg);
+                for (uint8_t i = 0; i < size; i++)
+                    wire->write(data[i]);
+                sts = wire->endTransmission();
+                if (sts == 0 || attempt >= RETRIES) break;
+                delay(BACKOFF_MS << attempt);
+            }
             if (sts != 0)
             {
                 Serial.print("I2C ERROR : ");
                 Serial.println(sts);
             }
+            // keep the shadow in step with what the device acknowledged,
+            // multi-byte writes toggle within the register pair
+            for (uint8_t i = 0; i < size; i++) {
+                uint8_t r = (reg & ~1) | ((reg + i) & 1);
+                if (!cacheable(r)) continue;
+                if (sts == 0) {
+                    shadow[r] = data[i];
+                    shadowValid |= (1 << r);
+                } else {
+                    shadowValid &= ~(1 << r);
+                }
+            }
             return (sts == 0);
         }
 
@@ -0,0 +1,116 @@
+#include <string.h>
+#include "ws_cmd.h"
+
+// Must stay sorted by name (ASCII order), see wsIsSorted()
+constexpr WsCommand WS_COMMANDS[] = {
+    { "E",      WsAction::DIRECTION, 3 },
+    { "NE",     WsAction::DIRECTION, 2 },
+    { "NN",     WsAction::DIRECTION, 1 },
+    { "NW",     WsAction::DIRECTION, 8 },
+    { "S",      WsAction::DIRECTION, 5 },
+    { "SE",     WsAction::DIRECTION, 4 },
+    { "SW",     WsAction::DIRECTION, 6 },
+    { "W",      WsAction::DIRECTION, 7 },
+    { "clear",  WsAction::CLEAR,     0 },
+    { "scan",   WsAction::SCAN,      0 },
+    { "toggle", WsAction::TOGGLE,    0 },
+};
+constexpr size_t WS_COMMAND_COUNT = sizeof(WS_COMMANDS) / sizeof(WS_COMMANDS[0]);
+static_assert(wsIsSorted(WS_COMMANDS, WS_COMMAND_COUNT), "WS_COMMANDS must be sorted by name");
+
+static const char ACTION_KEY[]  = "action";
+static const size_t ACTION_LEN  = sizeof(ACTION_KEY) - 1;
+
+static bool isSpace(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Skips a string starting right after its opening quote, returns the index
+// of the closing quote or len if unterminated. Sets *escaped if the string
+// contains a backslash.
+static size_t skipString(const uint8_t *data, size_t len, size_t i, bool *escaped) {
+    *escaped = false;
+    while (i < len) {
+        if (data[i] == '\\') {
+            *escaped = true;
+            i += 2;
+            continue;
+        }
+        if (data[i] == '"') return i;
+        i++;
+    }
+    return len;
+}
+
+bool wsFindAction(const uint8_t *data, size_t len, const char **value, size_t *valueLen) {
+    int  depth     = 0;
+    bool expectKey = false;
+    size_t i = 0;
+
+    while (i < len) {
+        uint8_t c = data[i];
+
+        if (c == '{') {
+            depth++;
+            expectKey = (depth == 1);
+        } else if (c == '}' || c == ']') {
+            depth--;
+        } else if (c == '[') {
+            depth++;
+        } else if (c == ',') {
+            expectKey = (depth == 1);
+        } else if (c == '"') {
+            bool escaped;
+            size_t start = i + 1;
+            size_t end   = skipString(data, len, start, &escaped);
+            if (end >= len) return false;
+            i = end;
+
+            if (expectKey) {
+                expectKey = false;
+                bool match = !escaped && end - start == ACTION_LEN
+                          && memcmp(&data[start], ACTION_KEY, ACTION_LEN) == 0;
+                if (match) {
+                    // expect  : "value"
+                    size_t j = end + 1;
+                    while (j < len && isSpace(data[j])) j++;
+                    if (j >= len || data[j] != ':') return false;
+                    j++;
+                    while (j < len && isSpace(data[j])) j++;
+                    if (j >= len || data[j] != '"') return false;
+
+                    size_t vstart = j + 1;
+                    size_t vend   = skipString(data, len, vstart, &escaped);
+                    if (vend >= len || escaped) return false;
+                    // a raw NUL is not valid JSON, and no name has one
+                    if (memchr(&data[vstart], '\0', vend - vstart)) return false;
+
+                    *value    = (const char *)&data[vstart];
+                    *valueLen = vend - vstart;
+                    return true;
+                }
+            }
+        }
+        i++;
+    }
+    return false;
+}
+
+const WsCommand *wsLookup(const WsCommand *table, size_t count, const char *name, size_t nameLen) {
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const char *key    = table[mid].name;
+        size_t      keyLen = strlen(key);
+
+        // name is not NUL-terminated, never read key or name past their ends
+        int cmp = memcmp(key, name, keyLen < nameLen ? keyLen : nameLen);
+        if (cmp == 0 && keyLen != nameLen) cmp = keyLen < nameLen ? -1 : 1;
+
+        if (cmp == 0) return &table[mid];
+        if (cmp < 0) lo = mid + 1;
+        else         hi = mid;
+    }
+    return NULL;
+}
@@ -0,0 +1,50 @@
+#ifndef WS_CMD_H_
+#define WS_CMD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ----------------------------------------------------------------------------
+// WebSocket command dispatcher
+// ----------------------------------------------------------------------------
+//
+// Incoming frames look like {"action":"NE"}. Instead of deserializing the
+// whole document, wsFindAction() scans the frame in place for the top-level
+// "action" string and wsLookup() binary-searches WS_COMMANDS, which is sorted
+// at compile time (checked with wsIsSorted() in a static_assert). The table
+// names the action and its argument, the firmware maps actions to handlers.
+// Nothing here touches the heap.
+
+enum class WsAction : uint8_t { DIRECTION, CLEAR, SCAN, TOGGLE };
+
+struct WsCommand {
+    const char *name;
+    WsAction    action;
+    uint8_t     arg;
+};
+
+// The commands the web UI sends, sorted by name. A direction's arg is its
+// antenna direction, 1 = NN clockwise to 8 = NW.
+extern const WsCommand WS_COMMANDS[];
+extern const size_t    WS_COMMAND_COUNT;
+
+// strcmp() usable in constant expressions (C++11 single-return form)
+constexpr int wsStrCmp(const char *a, const char *b) {
+    return (*a != *b || *a == '\0') ? (int)(uint8_t)*a - (int)(uint8_t)*b
+                                    : wsStrCmp(a + 1, b + 1);
+}
+
+// true if the names in table are strictly ascending
+constexpr bool wsIsSorted(const WsCommand *table, size_t count) {
+    return count < 2 || (wsStrCmp(table[0].name, table[1].name) < 0 && wsIsSorted(table + 1, count - 1));
+}
+
+// Locates the value of the top-level "action" key. On success, *value points
+// into data and *valueLen holds its length. Values with escape sequences or
+// NUL bytes are rejected since no command name needs them.
+bool wsFindAction(const uint8_t *data, size_t len, const char **value, size_t *valueLen);
+
+// Returns the entry matching name[0..nameLen), or NULL.
+const WsCommand *wsLookup(const WsCommand *table, size_t count, const char *name, size_t nameLen);
+
+#endif /* WS_CMD_H_ */
@@ -0,0 +1,106 @@
+#include "ws_outbox.h"
+#include <stddef.h>
+#include <new>
+
+WsFrame *wsFrameAlloc(size_t len, bool binary) {
+    if (len > 0xffff) return NULL;
+    WsFrame *f = (WsFrame *)malloc(offsetof(WsFrame, data) + (len ? len : 1));
+    if (f == NULL) return NULL;
+    new (&f->refs) std::atomic<uint16_t>(1);
+    f->binary = binary;
+    f->len    = len;
+    return f;
+}
+
+void wsFrameRef(WsFrame *frame) {
+    frame->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void wsFrameRelease(WsFrame *frame) {
+    if (frame && frame->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) free(frame);
+}
+
+void WsOutbox::removeAt(uint8_t i) {
+    for (; i + 1 < count; i++) q[i] = q[i + 1];
+    count--;
+}
+
+bool WsOutbox::push(WsFrameClass cls, WsFrame *frame) {
+    WsFrame *evicted = NULL;
+    bool ok = true;
+
+    wsFrameRef(frame);
+    portENTER_CRITICAL(&mux);
+
+    int8_t state = -1, telemetry = -1;
+    for (uint8_t i = 0; i < count; i++) {
+        if (q[i].cls == WsFrameClass::STATE) state = i;
+        else if (q[i].cls == WsFrameClass::TELEMETRY && telemetry < 0) telemetry = i;
+    }
+
+    if (cls == WsFrameClass::STATE && state >= 0) {
+        evicted = q[state].frame;
+        q[state].frame = frame;
+        replacedCount++;
+    } else {
+        // everything but the state frame has to fit into WS_OUTBOX_LEN - 1
+        uint8_t others = count - (state >= 0 ? 1 : 0);
+        bool full = cls == WsFrameClass::STATE ? count >= WS_OUTBOX_LEN : others >= WS_OUTBOX_LEN - 1;
+        if (full) {
+            if (telemetry >= 0) {
+                evicted = q[telemetry].frame;
+                removeAt(telemetry);
+                droppedCount++;
+            } else if (cls == WsFrameClass::TELEMETRY) {
+                evicted = frame;            // nothing older to give up
+                droppedCount++;
+                frame = NULL;
+            } else {
+                evicted = frame;            // an ACK that cannot be queued
+                frame = NULL;
+                ok = false;
+            }
+        }
+        if (frame) {
+            q[count].cls   = cls;
+            q[count].frame = frame;
+            count++;
+            if (count > maxCount) maxCount = count;
+        }
+    }
+
+    portEXIT_CRITICAL(&mux);
+    wsFrameRelease(evicted);
+    return ok;
+}
+
+WsFrame *WsOutbox::peek() {
+    portENTER_CRITICAL(&mux);
+    WsFrame *f = count ? q[0].frame : NULL;
+    if (f) wsFrameRef(f);
+    portEXIT_CRITICAL(&mux);
+    return f;
+}
+
+void WsOutbox::pop(WsFrame *sent) {
+    WsFrame *f = NULL;
+    portENTER_CRITICAL(&mux);
+    // a state frame replaced since peek() is still unsent and stays
+    if (count && q[0].frame == sent) {
+        f = q[0].frame;
+        removeAt(0);
+        sentCount++;
+    }
+    portEXIT_CRITICAL(&mux);
+    wsFrameRelease(f);
+}
+
+void WsOutbox::clear() {
+    Entry copy[WS_OUTBOX_LEN];
+    portENTER_CRITICAL(&mux);
+    uint8_t n = count;
+    memcpy(copy, q, sizeof(Entry) * n);
+    count = 0;
+    portEXIT_CRITICAL(&mux);
+    for (uint8_t i = 0; i < n; i++) wsFrameRelease(copy[i].frame);
+}
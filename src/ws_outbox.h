@@ -0,0 +1,81 @@
+#ifndef WS_OUTBOX_H_
+#define WS_OUTBOX_H_
+
+#include <Arduino.h>
+#include <atomic>
+
+// ----------------------------------------------------------------------------
+// Per-client WebSocket send queues
+// ----------------------------------------------------------------------------
+//
+// Every client gets a small bounded outbox instead of an unbounded queue
+// inside the WebSocket library. Frames are only handed to the library when
+// the client's TCP connection can take them, so a slow client's backlog stays
+// here, at WS_OUTBOX_LEN frames.
+//
+// What happens when the outbox fills up depends on the frame class:
+//
+//   STATE      latest wins: replaces a queued state frame in place, and one
+//              slot is kept free for it, so it is never dropped
+//   TELEMETRY  dropped first: the oldest queued telemetry frame makes room
+//              for any newer frame
+//   ACK        never dropped: if no telemetry can make room, push() fails and
+//              the client has to be closed
+//
+// A frame is built once and shared by all outboxes through a reference
+// count. Outboxes can be filled from any task, each one has its own lock.
+
+#define WS_OUTBOX_LEN   8
+
+enum class WsFrameClass : uint8_t { ACK, STATE, TELEMETRY };
+
+struct WsFrame {
+    std::atomic<uint16_t> refs;
+    bool     binary;
+    uint16_t len;
+    uint8_t  data[1];       // len bytes
+};
+
+// Returns a frame with one reference, or NULL
+WsFrame *wsFrameAlloc(size_t len, bool binary);
+void     wsFrameRef(WsFrame *frame);
+void     wsFrameRelease(WsFrame *frame);
+
+class WsOutbox {
+public:
+    // Queues frame, taking a reference. Returns false only for an ACK that
+    // does not fit.
+    bool push(WsFrameClass cls, WsFrame *frame);
+
+    // Oldest frame with a reference for the caller to release, NULL when
+    // empty. pop() removes it once it was handed on.
+    WsFrame *peek();
+    void pop(WsFrame *sent);
+
+    // Drops everything, e.g. when the client went away
+    void clear();
+
+    uint8_t  depth()    const { return count; }
+    uint8_t  maxDepth() const { return maxCount; }
+    uint32_t dropped()  const { return droppedCount; }     // telemetry frames
+    uint32_t replaced() const { return replacedCount; }    // state frames superseded before sending
+    uint32_t sent()     const { return sentCount; }
+
+private:
+    struct Entry {
+        WsFrameClass cls;
+        WsFrame     *frame;
+    };
+
+    void removeAt(uint8_t i);
+
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    Entry    q[WS_OUTBOX_LEN];
+    uint8_t  count    = 0;
+    uint8_t  maxCount = 0;
+    uint32_t droppedCount  = 0;
+    uint32_t replacedCount = 0;
+    uint32_t sentCount     = 0;
+};
+
+#endif /* WS_OUTBOX_H_ */
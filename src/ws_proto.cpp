@@ -0,0 +1,97 @@
+#include "ws_proto.h"
+#include <string.h>
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+size_t encodeStateFrame(const StateFrame &frame, uint8_t *buf, size_t len) {
+    if (len < WS_STATE_FRAME_LEN) return 0;
+    buf[0] = WS_PROTO_VERSION;
+    buf[1] = WS_FRAME_STATE;
+    buf[2] = frame.status;
+    buf[3] = frame.actualDir;
+    buf[4] = frame.wantedDir;
+    buf[5] = frame.flags;
+    put16(&buf[6], frame.swr);
+    put32(&buf[8], frame.seq);
+    put32(&buf[12], frame.timestamp);
+    return WS_STATE_FRAME_LEN;
+}
+
+bool decodeStateFrame(const uint8_t *buf, size_t len, StateFrame &frame) {
+    if (len < WS_STATE_FRAME_LEN) return false;
+    if (buf[0] != WS_PROTO_VERSION || buf[1] != WS_FRAME_STATE) return false;
+    frame.status    = buf[2];
+    frame.actualDir = buf[3];
+    frame.wantedDir = buf[4];
+    frame.flags     = buf[5];
+    frame.swr       = get16(&buf[6]);
+    frame.seq       = get32(&buf[8]);
+    frame.timestamp = get32(&buf[12]);
+    return true;
+}
+
+size_t encodeCaptureHeader(const CaptureFrame &frame, uint8_t *buf, size_t len) {
+    if (len < WS_CAPTURE_HEADER_LEN) return 0;
+    buf[0] = WS_PROTO_VERSION;
+    buf[1] = WS_FRAME_CAPTURE;
+    buf[2] = frame.dir;
+    buf[3] = frame.channel;
+    buf[4] = frame.slope;
+    buf[5] = frame.channels;
+    put16(&buf[6], frame.level);
+    put32(&buf[8], frame.id);
+    put32(&buf[12], frame.timestamp);
+    put16(&buf[16], frame.pre);
+    put16(&buf[18], frame.post);
+    put32(&buf[20], frame.sampleRate);
+    return WS_CAPTURE_HEADER_LEN;
+}
+
+size_t encodeScanFrame(const ScanEntry *entries, uint8_t count, uint8_t status, uint32_t durationMs,
+                       uint8_t *buf, size_t len) {
+    size_t total = WS_SCAN_HEADER_LEN + (size_t)count * WS_SCAN_ENTRY_LEN;
+    if (len < total) return 0;
+    buf[0] = WS_PROTO_VERSION;
+    buf[1] = WS_FRAME_SCAN;
+    buf[2] = status;
+    buf[3] = count;
+    put32(&buf[4], durationMs);
+    uint8_t *p = buf + WS_SCAN_HEADER_LEN;
+    for (uint8_t i = 0; i < count; i++, p += WS_SCAN_ENTRY_LEN) {
+        p[0] = entries[i].dir;
+        p[1] = entries[i].readings;
+        put16(&p[2], entries[i].swrAvg);
+        put16(&p[4], entries[i].swrMin);
+        put16(&p[6], entries[i].swrMax);
+    }
+    return total;
+}
+
+size_t encodeAckFrame(bool ok, const char *action, size_t actionLen, uint8_t *buf, size_t len) {
+    if (actionLen > WS_ACK_ACTION_MAX) actionLen = WS_ACK_ACTION_MAX;
+    if (len < WS_ACK_HEADER_LEN + actionLen) return 0;
+    buf[0] = WS_PROTO_VERSION;
+    buf[1] = WS_FRAME_ACK;
+    buf[2] = ok ? 1 : 0;
+    buf[3] = (uint8_t)actionLen;
+    memcpy(&buf[4], action, actionLen);
+    return WS_ACK_HEADER_LEN + actionLen;
+}
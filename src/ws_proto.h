@@ -0,0 +1,144 @@
+#ifndef WS_PROTO_H_
+#define WS_PROTO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ----------------------------------------------------------------------------
+// Binary WebSocket protocol
+// ----------------------------------------------------------------------------
+//
+// Clients connecting to /ws/bin receive fixed-layout little-endian frames
+// instead of the JSON text sent on /ws. Every frame starts with the protocol
+// version and a frame type, so new frame types can be added without breaking
+// existing clients. This header has no Arduino dependencies and builds on the
+// host as well.
+//
+// State frame layout (WS_STATE_FRAME_LEN bytes):
+//
+//   offset  size  field
+//   0       1     version      (WS_PROTO_VERSION)
+//   1       1     type         (WS_FRAME_STATE)
+//   2       1     status       (0 = off, 1 = on)
+//   3       1     actualDir    (0 = none, 1..8)
+//   4       1     wantedDir    (0 = none, 1..8)
+//   5       1     flags        (WS_FLAG_*)
+//   6       2     swr          (SWR * 256, 0 = no forward power)
+//   8       4     seq          (incremented on every frame sent)
+//   12      4     timestamp    (millis() when the frame was built)
+//
+// Capture frame layout (WS_CAPTURE_HEADER_LEN bytes, then the samples):
+//
+//   offset  size  field
+//   0       1     version      (WS_PROTO_VERSION)
+//   1       1     type         (WS_FRAME_CAPTURE)
+//   2       1     dir          (actual_dir when it triggered)
+//   3       1     channel      (trigger channel, 0 = forward, 1 = reflected)
+//   4       1     slope        (0 = rising, 1 = falling)
+//   5       1     channels     (ADC channels per sample)
+//   6       2     level        (trigger level, raw ADC counts)
+//   8       4     id           (capture number, from 1)
+//   12      4     timestamp    (millis() at the trigger)
+//   16      2     pre          (samples before the trigger)
+//   18      2     post         (samples from the trigger on)
+//   20      4     sampleRate   (Hz)
+//   24      ...   samples      ((pre + post) * channels, 2 bytes each)
+//
+// Scan frame layout (WS_SCAN_HEADER_LEN bytes, then count entries of
+// WS_SCAN_ENTRY_LEN bytes, best SWR first):
+//
+//   offset  size  field
+//   0       1     version      (WS_PROTO_VERSION)
+//   1       1     type         (WS_FRAME_SCAN)
+//   2       1     status       (SCAN_DONE or the abort reason, see antenna_scan.h)
+//   3       1     count
+//   4       4     duration     (ms)
+//
+//   entry   size  field
+//   0       1     dir
+//   1       1     readings     (0 = no signal, ranked last)
+//   2       2     swrAvg       (SWR * 256)
+//   4       2     swrMin
+//   6       2     swrMax
+//
+// Ack frame layout (WS_ACK_HEADER_LEN bytes, then the action name):
+//
+//   offset  size  field
+//   0       1     version      (WS_PROTO_VERSION)
+//   1       1     type         (WS_FRAME_ACK)
+//   2       1     ok           (0 = unknown action)
+//   3       1     length       (of the action name, at most WS_ACK_ACTION_MAX)
+//   4       ...   action
+
+#define WS_PROTO_VERSION    2
+
+#define WS_FRAME_STATE      0x01
+#define WS_FRAME_CAPTURE    0x02
+#define WS_FRAME_SCAN       0x03
+#define WS_FRAME_ACK        0x04
+
+#define WS_STATE_FRAME_LEN  16
+#define WS_CAPTURE_HEADER_LEN 24
+#define WS_SCAN_HEADER_LEN  8
+#define WS_SCAN_ENTRY_LEN   8
+#define WS_ACK_HEADER_LEN   4
+#define WS_ACK_ACTION_MAX   32
+
+// state frame flags
+#define WS_FLAG_RF          0x01    // RF present, direction changes are held off
+#define WS_FLAG_SWR_TRIP    0x02    // high-SWR interlock tripped, needs "clear"
+#define WS_FLAG_SCAN        0x04    // antenna scan running
+#define WS_FLAG_RELAY_FAULT 0x08    // relays did not switch, retried by "clear" or a direction
+
+struct StateFrame {
+    uint8_t  status;
+    uint8_t  actualDir;
+    uint8_t  wantedDir;
+    uint8_t  flags;
+    uint16_t swr;
+    uint32_t seq;
+    uint32_t timestamp;
+};
+
+struct CaptureFrame {
+    uint8_t  dir;
+    uint8_t  channel;
+    uint8_t  slope;
+    uint8_t  channels;
+    uint16_t level;
+    uint32_t id;
+    uint32_t timestamp;
+    uint16_t pre;
+    uint16_t post;
+    uint32_t sampleRate;
+};
+
+struct ScanEntry {
+    uint8_t  dir;
+    uint8_t  readings;
+    uint16_t swrAvg;
+    uint16_t swrMin;
+    uint16_t swrMax;
+};
+
+// Writes the frame into buf and returns the number of bytes written,
+// or 0 if len is smaller than WS_STATE_FRAME_LEN.
+size_t encodeStateFrame(const StateFrame &frame, uint8_t *buf, size_t len);
+
+// Parses a state frame, returns false on a short buffer, an unknown version
+// or a frame of another type.
+bool decodeStateFrame(const uint8_t *buf, size_t len, StateFrame &frame);
+
+// Writes the capture header into buf and returns WS_CAPTURE_HEADER_LEN, or 0
+// if len is smaller. The samples follow at buf + WS_CAPTURE_HEADER_LEN.
+size_t encodeCaptureHeader(const CaptureFrame &frame, uint8_t *buf, size_t len);
+
+// Writes a scan frame into buf and returns its length, or 0 if len is too small.
+size_t encodeScanFrame(const ScanEntry *entries, uint8_t count, uint8_t status, uint32_t durationMs,
+                       uint8_t *buf, size_t len);
+
+// Writes an ack frame into buf and returns its length, or 0 if len is too
+// small. Longer action names are cut to WS_ACK_ACTION_MAX.
+size_t encodeAckFrame(bool ok, const char *action, size_t actionLen, uint8_t *buf, size_t len);
+
+#endif /* WS_PROTO_H_ */
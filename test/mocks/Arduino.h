@@ -0,0 +1,88 @@
+#ifndef MOCK_ARDUINO_H_
+#define MOCK_ARDUINO_H_
+
+// ----------------------------------------------------------------------------
+// Host stand-in for the parts of Arduino-ESP32 and FreeRTOS the modules use
+// ----------------------------------------------------------------------------
+//
+// Only for the native test build. Time is a fake clock that the tests and
+// delay() move forward. Tasks are not started: xTaskCreatePinnedToCore()
+// succeeds without running anything and the tests step the module instead.
+// Critical sections are empty, the tests using these modules are single
+// threaded. Everything is inline or static, every test binary links all the
+// native sources.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IRAM_ATTR
+
+#define LOW                 0
+#define HIGH                1
+#define INPUT               0x01
+#define OUTPUT              0x03
+#define INPUT_PULLUP        0x05
+#define OUTPUT_OPEN_DRAIN   0x13
+
+// fake clock in microseconds
+inline uint32_t &mockMicros() {
+    static uint32_t now = 0;
+    return now;
+}
+inline void mockAdvance(uint32_t us) { mockMicros() += us; }
+
+inline uint32_t micros() { return mockMicros(); }
+inline uint32_t millis() { return mockMicros() / 1000; }
+inline void delay(uint32_t ms) { mockAdvance(ms * 1000); }
+inline void delayMicroseconds(uint32_t us) { mockAdvance(us); }
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int  digitalRead(uint8_t) { return HIGH; }
+
+struct MockSerial {
+    size_t print(const char *) { return 0; }
+    size_t print(int) { return 0; }
+    size_t println() { return 0; }
+    size_t println(const char *) { return 0; }
+    size_t println(int) { return 0; }
+    size_t printf(const char *, ...) { return 0; }
+};
+static MockSerial Serial __attribute__((unused));
+
+// FreeRTOS
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void    *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdPASS              1
+#define pdFAIL              0
+#define pdTRUE              1
+#define pdFALSE             0
+#define portMAX_DELAY       0xffffffffUL
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+struct portMUX_TYPE {
+    uint32_t owner;
+};
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+#define portENTER_CRITICAL(mux)         ((void)(mux))
+#define portEXIT_CRITICAL(mux)          ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux)     ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)      ((void)(mux))
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *,
+                                          UBaseType_t, TaskHandle_t *task, BaseType_t) {
+    if (task) *task = NULL;
+    return pdPASS;
+}
+inline void     xTaskNotifyGive(TaskHandle_t) {}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 1; }
+inline void     vTaskDelay(TickType_t ticks) { mockAdvance(ticks * 1000); }
+
+#endif /* MOCK_ARDUINO_H_ */
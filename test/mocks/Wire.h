@@ -0,0 +1,122 @@
+#ifndef MOCK_WIRE_H_
+#define MOCK_WIRE_H_
+
+// ----------------------------------------------------------------------------
+// Host stand-in for TwoWire with simulated TCA9539 expanders
+// ----------------------------------------------------------------------------
+//
+// Only for the native test build. attach() puts an expander with the
+// power-on register values at an address, everything else NACKs (status 2).
+// Multi-byte transfers toggle within a register pair like the real part.
+// A write, or a register read with a repeated start, counts as one
+// transaction and moves the mock clock forward by busUs.
+//
+// Faults for the tests: failNext makes the next transactions fail with
+// failStatus, and an expander's stuckBits are OUTPUT_PORT1 bits that keep
+// their value on a write, so a read-back differs.
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+    struct Expander {
+        bool    present;
+        uint8_t regs[8];
+        uint8_t ptr;
+        uint8_t stuckBits;      // OUTPUT_PORT1 bits that ignore writes
+        uint32_t writes;        // write transactions
+        uint32_t reads;         // read transactions
+    };
+
+    Expander dev[128] = {};
+    uint32_t transactions = 0;
+    uint32_t begins       = 0;
+    uint32_t busUs        = 0;  // bus time of a transaction
+    uint8_t  failNext     = 0;  // number of transactions to fail
+    uint8_t  failStatus   = 5;  // status of a failing one (5 = timeout)
+
+    void attach(uint8_t addr) {
+        Expander &e = dev[addr & 0x7f];
+        e = {};
+        e.present = true;
+        static const uint8_t POWER_ON[8] = { 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0xff, 0xff };
+        memcpy(e.regs, POWER_ON, sizeof(POWER_ON));
+    }
+
+    void resetCounters() {
+        transactions = 0;
+        begins       = 0;
+        for (Expander &e : dev) e.writes = e.reads = 0;
+    }
+
+    // Arduino API
+    bool begin(int = -1, int = -1, uint32_t = 0) { return true; }
+    bool end() { return true; }
+    uint32_t getClock() { return 400000; }
+    void setTimeOut(uint16_t) {}
+
+    void beginTransmission(uint8_t addr) {
+        txAddr = addr & 0x7f;
+        txLen  = 0;
+        begins++;
+    }
+    size_t write(uint8_t b) {
+        if (txLen < sizeof(tx)) tx[txLen++] = b;
+        return 1;
+    }
+    size_t write(const uint8_t *data, size_t len) {
+        for (size_t i = 0; i < len; i++) write(data[i]);
+        return len;
+    }
+
+    uint8_t endTransmission(bool sendStop = true) {
+        if (sendStop) {
+            transactions++;
+            mockAdvance(busUs);
+        }
+        if (failNext) {
+            failNext--;
+            return failStatus;
+        }
+        Expander &e = dev[txAddr];
+        if (!e.present) return 2;
+        if (txLen == 0) return 0;
+        e.ptr = tx[0] & 7;
+        if (txLen > 1) e.writes++;
+        for (size_t i = 1; i < txLen; i++) {
+            uint8_t r = (e.ptr & ~1) | ((e.ptr + i - 1) & 1);
+            if (r < 2) continue;                        // input registers are read only
+            uint8_t keep = r == 2 ? e.stuckBits : 0;
+            e.regs[r] = (tx[i] & ~keep) | (e.regs[r] & keep);
+        }
+        return 0;
+    }
+
+    size_t requestFrom(uint8_t addr, size_t len, bool = true) {
+        transactions++;
+        mockAdvance(busUs);
+        rxLen = rxPos = 0;
+        if (failNext) {
+            failNext--;
+            return 0;
+        }
+        Expander &e = dev[addr & 0x7f];
+        if (!e.present) return 0;
+        e.reads++;
+        for (size_t i = 0; i < len && rxLen < sizeof(rx); i++) {
+            rx[rxLen++] = e.regs[(e.ptr & ~1) | ((e.ptr + i) & 1)];
+        }
+        return rxLen;
+    }
+    int available() { return rxLen - rxPos; }
+    int read() { return rxPos < rxLen ? rx[rxPos++] : -1; }
+
+private:
+    uint8_t txAddr = 0;
+    uint8_t tx[16];
+    size_t  txLen = 0;
+    uint8_t rx[16];
+    size_t  rxLen = 0, rxPos = 0;
+};
+
+#endif /* MOCK_WIRE_H_ */
@@ -0,0 +1,51 @@
+#ifndef MOCK_SOC_GPIO_REG_H_
+#define MOCK_SOC_GPIO_REG_H_
+
+// ----------------------------------------------------------------------------
+// Host stand-in for the ESP32-S3 GPIO output set/clear registers
+// ----------------------------------------------------------------------------
+//
+// Only for the native test build. REG_WRITE() to the W1TS/W1TC registers
+// sets or clears bits of the two output words, out for GPIO 0..31 and out1
+// for GPIO 32 and up, and counts the writes. On the target REG_WRITE comes
+// from soc/soc.h.
+
+#include <stdint.h>
+
+#define DR_REG_GPIO_BASE        0x60004000
+#define GPIO_OUT_W1TS_REG       (DR_REG_GPIO_BASE + 0x0008)
+#define GPIO_OUT_W1TC_REG       (DR_REG_GPIO_BASE + 0x000c)
+#define GPIO_OUT1_W1TS_REG      (DR_REG_GPIO_BASE + 0x0014)
+#define GPIO_OUT1_W1TC_REG      (DR_REG_GPIO_BASE + 0x0018)
+
+struct MockGpio {
+    uint32_t out;
+    uint32_t out1;
+    uint32_t writes;
+};
+
+inline MockGpio &mockGpio() {
+    static MockGpio gpio = {};
+    return gpio;
+}
+
+// output level of a pin
+inline bool mockGpioLevel(uint8_t pin) {
+    return pin < 32 ? (mockGpio().out >> pin) & 1 : (mockGpio().out1 >> (pin - 32)) & 1;
+}
+
+inline void mockRegWrite(uint32_t reg, uint32_t value) {
+    MockGpio &g = mockGpio();
+    switch (reg) {
+        case GPIO_OUT_W1TS_REG:  g.out  |= value;  break;
+        case GPIO_OUT_W1TC_REG:  g.out  &= ~value; break;
+        case GPIO_OUT1_W1TS_REG: g.out1 |= value;  break;
+        case GPIO_OUT1_W1TC_REG: g.out1 &= ~value; break;
+        default: return;
+    }
+    g.writes++;
+}
+
+#define REG_WRITE(reg, value)   mockRegWrite((reg), (value))
+
+#endif /* MOCK_SOC_GPIO_REG_H_ */
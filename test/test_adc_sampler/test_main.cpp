@@ -0,0 +1,134 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "adc_pipeline.h"
+
+static AdcPipeline *adc;
+
+void setUp() {
+    adc = new AdcPipeline();
+    adc->begin(ADC_DECIMATION);
+}
+void tearDown() {
+    delete adc;
+}
+
+static bool push(uint16_t fwd, uint16_t ref, uint32_t nowMs = 0) {
+    AdcSample s = { { fwd, ref } };
+    return adc->push(s, nowMs);
+}
+
+// pushes one full window of a constant value, returns the published reading
+static AdcReading window(uint16_t fwd, uint16_t ref) {
+    for (uint16_t i = 0; i < ADC_DECIMATION; i++) push(fwd, ref);
+    AdcReading r;
+    adc->latest(r);
+    return r;
+}
+
+static void test_decimation() {
+    AdcReading r;
+    TEST_ASSERT_FALSE(adc->latest(r));
+
+    // a ramp 100..119 on the forward channel, the reflected one constant
+    for (uint16_t i = 0; i < ADC_DECIMATION - 1; i++) TEST_ASSERT_FALSE(push(100 + i, 40, 7));
+    TEST_ASSERT_FALSE(adc->latest(r));
+    TEST_ASSERT_TRUE(push(100 + ADC_DECIMATION - 1, 40, 8));
+
+    TEST_ASSERT_TRUE(adc->latest(r));
+    TEST_ASSERT_EQUAL(1, r.count);
+    TEST_ASSERT_EQUAL(8, r.timestamp);
+    TEST_ASSERT_EQUAL((100 + 100 + ADC_DECIMATION - 1) / 2, r.value[ADC_CH_FWD]);
+    TEST_ASSERT_EQUAL(100, r.min[ADC_CH_FWD]);
+    TEST_ASSERT_EQUAL(100 + ADC_DECIMATION - 1, r.max[ADC_CH_FWD]);
+    TEST_ASSERT_EQUAL(40, r.value[ADC_CH_REF]);
+    TEST_ASSERT_EQUAL(40, r.min[ADC_CH_REF]);
+    TEST_ASSERT_EQUAL(40, r.max[ADC_CH_REF]);
+
+    // one reading per ADC_DECIMATION samples, the extremes start over
+    int published = 0;
+    for (uint32_t i = 0; i < 100 * ADC_DECIMATION; i++) {
+        if (push(500, i & 1 ? 60 : 20)) published++;
+    }
+    TEST_ASSERT_EQUAL(100, published);
+    TEST_ASSERT_TRUE(adc->latest(r));
+    TEST_ASSERT_EQUAL(101, r.count);
+    TEST_ASSERT_EQUAL(500, r.min[ADC_CH_FWD]);
+    TEST_ASSERT_EQUAL(20, r.min[ADC_CH_REF]);
+    TEST_ASSERT_EQUAL(60, r.max[ADC_CH_REF]);
+}
+
+// A step from 0 to 1000 follows y += (x - y) / 2^ADC_IIR_SHIFT, give or
+// take the truncation, and settles on the input exactly.
+static void test_iir_step_response() {
+    TEST_ASSERT_EQUAL(0, window(0, 3000).value[ADC_CH_FWD]);
+    TEST_ASSERT_EQUAL(3000, window(0, 3000).value[ADC_CH_REF]);
+
+    double y = 0;
+    int settled = -1;
+    for (int n = 1; n <= 40; n++) {
+        AdcReading r = window(1000, 0);
+        y += (1000 - y) / (1 << ADC_IIR_SHIFT);
+        TEST_ASSERT_TRUE(r.value[ADC_CH_FWD] <= 1000);
+        TEST_ASSERT_TRUE(fabs(r.value[ADC_CH_FWD] - y) <= 1.0);
+        if (settled < 0 && r.value[ADC_CH_FWD] == 1000) settled = n;
+    }
+    // and the same way down on the other channel
+    TEST_ASSERT_EQUAL(1000, window(1000, 0).value[ADC_CH_FWD]);
+    TEST_ASSERT_EQUAL(0, window(1000, 0).value[ADC_CH_REF]);
+    TEST_ASSERT_TRUE(settled > 0 && settled < 30);
+
+    char msg[64];
+    snprintf(msg, sizeof(msg), "step settled after %d readings", settled);
+    TEST_MESSAGE(msg);
+}
+
+static void test_raw_ring() {
+    AdcSample s;
+    TEST_ASSERT_EQUAL(0, adc->head());
+    TEST_ASSERT_FALSE(adc->raw(0, s));
+
+    for (uint16_t i = 0; i < ADC_RING_LEN + 10; i++) push(i, 0);
+    uint32_t h = adc->head();
+    TEST_ASSERT_EQUAL(ADC_RING_LEN + 10, h);
+    TEST_ASSERT_TRUE(adc->raw(h - 1, s));
+    TEST_ASSERT_EQUAL(ADC_RING_LEN + 9, s.ch[ADC_CH_FWD]);
+    TEST_ASSERT_TRUE(adc->raw(h - (ADC_RING_LEN - 1), s));
+    TEST_ASSERT_EQUAL(11, s.ch[ADC_CH_FWD]);              // the oldest one left
+    TEST_ASSERT_FALSE(adc->raw(h - ADC_RING_LEN, s));     // being overwritten next
+    TEST_ASSERT_FALSE(adc->raw(h, s));                    // not there yet
+}
+
+// Simulated ADC: noisy samples through the whole pipeline
+static void test_benchmark_samples_per_second() {
+    const uint32_t N = 20000000;
+    static uint16_t noise[4096];
+    srand(5);
+    for (uint16_t &n : noise) n = rand() & 0xff;
+
+    uint32_t published = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < N; i++) {
+        AdcSample s = { { (uint16_t)(2000 + noise[i & 4095]), (uint16_t)(300 + noise[(i + 7) & 4095]) } };
+        if (adc->push(s, i / 2)) published++;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    TEST_ASSERT_EQUAL(N / ADC_DECIMATION, published);
+
+    double s = std::chrono::duration<double>(t1 - t0).count();
+    char msg[96];
+    snprintf(msg, sizeof(msg), "pipeline: %.1f M samples/s, %.1f ns per sample",
+             N / s / 1e6, s * 1e9 / N);
+    TEST_MESSAGE(msg);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_decimation);
+    RUN_TEST(test_iir_step_response);
+    RUN_TEST(test_raw_ring);
+    RUN_TEST(test_benchmark_samples_per_second);
+    return UNITY_END();
+}
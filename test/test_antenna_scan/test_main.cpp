@@ -0,0 +1,125 @@
+#include <unity.h>
+#include "antenna_scan.h"
+
+#define SETTLE_MS   20
+#define SWITCH_MS   15      // simulated relay switch time
+
+// SWR * 256 per direction 1..8, 0 = no forward signal there
+static const uint16_t SWR_AT[SCAN_DIRECTIONS + 1] = { 0, 700, 300, 0, 520, 260, 900, 0, 410 };
+
+static AntennaScan scan;
+static uint32_t now;
+static uint8_t  relayDir;       // what the relays have switched to
+static uint8_t  relayWant;
+static uint32_t relayDoneAt;
+static bool     relayStuck;
+
+void setUp() {
+    scan       = AntennaScan();
+    now        = 5000;
+    relayDir   = 2;
+    relayWant  = 2;
+    relayStuck = false;
+}
+void tearDown() {}
+
+// one ms of the loop: relays follow the scan, readings come in while they rest
+static bool step() {
+    if (scan.running() && scan.direction() != relayWant) {
+        relayWant   = scan.direction();
+        relayDoneAt = now + SWITCH_MS;
+    }
+    bool busy = relayDir != relayWant;
+    if (busy && !relayStuck && (int32_t)(now - relayDoneAt) >= 0) {
+        relayDir = relayWant;
+        busy     = false;
+    }
+    if (!busy && SWR_AT[relayDir]) {
+        SwrResult m = { 1000, 10, (uint16_t)(SWR_AT[relayDir] + (now & 3)), 100 };
+        scan.addReading(m);
+    }
+    bool ended = scan.update(now, relayDir, busy);
+    now++;
+    return ended;
+}
+
+static bool runUntilEnd(uint32_t maxMs) {
+    for (uint32_t i = 0; i < maxMs; i++) {
+        if (step()) return true;
+    }
+    return false;
+}
+
+static void test_full_sweep_ranks_by_swr() {
+    scan.start(relayDir, SETTLE_MS, now);
+    TEST_ASSERT_TRUE(scan.running());
+    TEST_ASSERT_TRUE(runUntilEnd(5000));
+
+    TEST_ASSERT_EQUAL(SCAN_DONE, scan.status());
+    TEST_ASSERT_EQUAL(SCAN_DIRECTIONS, scan.resultCount());
+    const uint8_t order[SCAN_DIRECTIONS] = { 5, 2, 8, 4, 1, 6, 3, 7 };
+    for (uint8_t i = 0; i < SCAN_DIRECTIONS; i++) {
+        TEST_ASSERT_EQUAL(order[i], scan.result(i).dir);
+    }
+    const ScanEntry &best = scan.result(0);
+    TEST_ASSERT_TRUE(best.readings > 50);
+    TEST_ASSERT_TRUE(best.swrMin >= 260 && best.swrMax <= 263);
+    TEST_ASSERT_TRUE(best.swrAvg >= best.swrMin && best.swrAvg <= best.swrMax);
+    TEST_ASSERT_EQUAL(0, scan.result(6).readings);
+    TEST_ASSERT_EQUAL(0, scan.result(7).swrAvg);
+
+    // back where it started, within the documented bound
+    TEST_ASSERT_EQUAL(2, scan.direction());
+    TEST_ASSERT_TRUE(scan.lastDuration() <= SCAN_DIRECTIONS * (SCAN_SWITCH_TIMEOUT_MS + SETTLE_MS + SCAN_WINDOW_MS));
+    TEST_ASSERT_TRUE(scan.lastDuration() >= SCAN_DIRECTIONS * (SETTLE_MS + SCAN_WINDOW_MS));
+    TEST_ASSERT_EQUAL(1, scan.sweeps());
+    TEST_ASSERT_FALSE(step());                      // the end is reported once
+}
+
+static void test_abort_keeps_partial_results() {
+    scan.start(relayDir, SETTLE_MS, now);
+    for (int i = 0; i < 400; i++) step();           // a few positions in
+    uint8_t done = scan.resultCount();
+    TEST_ASSERT_TRUE(done > 0 && done < SCAN_DIRECTIONS);
+
+    scan.abort(SCAN_ABORT_USER, 6, now);
+    TEST_ASSERT_FALSE(scan.running());
+    TEST_ASSERT_EQUAL(6, scan.direction());         // the commanded direction, not the old one
+    TEST_ASSERT_EQUAL(SCAN_ABORT_USER, scan.status());
+    TEST_ASSERT_EQUAL(done, scan.resultCount());
+    TEST_ASSERT_TRUE(step());
+
+    scan.abort(SCAN_ABORT_RF, 1, now);              // ignored when idle
+    TEST_ASSERT_EQUAL(SCAN_ABORT_USER, scan.status());
+    TEST_ASSERT_EQUAL(6, scan.direction());
+}
+
+static void test_relay_timeout_aborts() {
+    relayStuck = true;
+    scan.start(relayDir, SETTLE_MS, now);
+    TEST_ASSERT_TRUE(runUntilEnd(1000));
+    TEST_ASSERT_EQUAL(SCAN_ABORT_RELAY, scan.status());
+    TEST_ASSERT_EQUAL(0, scan.resultCount());
+    TEST_ASSERT_EQUAL(SCAN_SWITCH_TIMEOUT_MS, scan.lastDuration());
+    TEST_ASSERT_EQUAL(2, scan.direction());
+}
+
+static void test_restart_clears_results() {
+    scan.start(relayDir, SETTLE_MS, now);
+    TEST_ASSERT_TRUE(runUntilEnd(5000));
+    scan.start(relayDir, SETTLE_MS, now);
+    TEST_ASSERT_EQUAL(0, scan.resultCount());
+    TEST_ASSERT_TRUE(runUntilEnd(5000));
+    TEST_ASSERT_EQUAL(SCAN_DIRECTIONS, scan.resultCount());
+    TEST_ASSERT_EQUAL(2, scan.sweeps());
+    TEST_ASSERT_TRUE(scan.maxDuration() >= scan.lastDuration());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_sweep_ranks_by_swr);
+    RUN_TEST(test_abort_keeps_partial_results);
+    RUN_TEST(test_relay_timeout_aborts);
+    RUN_TEST(test_restart_clears_results);
+    return UNITY_END();
+}
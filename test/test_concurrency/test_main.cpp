@@ -0,0 +1,138 @@
+#include <unity.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "seqlock.h"
+#include "spsc_queue.h"
+
+// Stress tests for the task hand-over primitives, run on host threads. A
+// torn copy or a lost item is a failure; the counts depend on scheduling.
+// The spinning sides yield, so this also finishes on a single core.
+
+// odd size, so the copy is not a whole number of words
+struct Snapshot {
+    uint32_t a, b, c;
+    uint8_t  d;
+};
+
+static bool consistent(const Snapshot &s) {
+    return s.b == s.a * 3 && s.c == s.a + 7 && s.d == (uint8_t)s.a;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_seqlock_single_thread() {
+    Seqlock<Snapshot> lock;
+    Snapshot s = { 1, 2, 3, 4 };
+    TEST_ASSERT_EQUAL(0, lock.read(s));
+    TEST_ASSERT_EQUAL(0, s.a);                      // zero before the first write
+
+    lock.write({ 5, 15, 12, 5 });
+    lock.write({ 6, 18, 13, 6 });
+    TEST_ASSERT_EQUAL(2, lock.read(s));
+    TEST_ASSERT_EQUAL(2, lock.writes());
+    TEST_ASSERT_EQUAL(6, s.a);
+    TEST_ASSERT_TRUE(consistent(s));
+}
+
+static void test_seqlock_readers_never_tear() {
+    Seqlock<Snapshot> lock;
+    std::atomic<bool> stop{false};
+    long torn[2] = {}, reads[2] = {}, backwards[2] = {};
+
+    std::thread readers[2];
+    for (int r = 0; r < 2; r++) {
+        readers[r] = std::thread([&, r] {
+            uint32_t last = 0;
+            while (!stop.load()) {
+                Snapshot s;
+                uint32_t n = lock.read(s);
+                reads[r]++;
+                if (n && !consistent(s)) torn[r]++;
+                if (n < last) backwards[r]++;
+                last = n;
+                std::this_thread::yield();
+            }
+        });
+    }
+    const uint32_t N = 200000;
+    for (uint32_t i = 1; i <= N; i++) {
+        lock.write({ i, i * 3, i + 7, (uint8_t)i });
+        if ((i & 1023) == 0) std::this_thread::yield();
+    }
+    stop = true;
+    for (int r = 0; r < 2; r++) readers[r].join();
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "seqlock: %u writes, %ld + %ld reads", (unsigned)N, reads[0], reads[1]);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL(N, lock.writes());
+    TEST_ASSERT_EQUAL(0, torn[0] + torn[1]);
+    TEST_ASSERT_EQUAL(0, backwards[0] + backwards[1]);
+}
+
+static void test_spsc_full_and_empty() {
+    SpscQueue<uint32_t, 4> q;
+    uint32_t v;
+    TEST_ASSERT_FALSE(q.pop(v));
+    for (uint32_t i = 0; i < 4; i++) TEST_ASSERT_TRUE(q.push(i));
+    TEST_ASSERT_FALSE(q.push(99));
+    TEST_ASSERT_EQUAL(4, q.size());
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(q.pop(v));
+        TEST_ASSERT_EQUAL(i, v);
+    }
+    TEST_ASSERT_EQUAL(0, q.size());
+}
+
+// a small queue so both sides keep running into full and empty
+static void test_spsc_keeps_order_under_load() {
+    SpscQueue<uint32_t, 16> q;
+    const uint32_t N = 200000;
+    uint32_t fullPushes = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        for (uint32_t i = 1; i <= N;) {
+            if (q.push(i)) {
+                i++;
+            } else {
+                fullPushes++;
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint32_t expect = 1, outOfOrder = 0;
+    uint64_t sum = 0;
+    while (expect <= N) {
+        uint32_t v;
+        if (!q.pop(v)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (v != expect) outOfOrder++;
+        sum += v;
+        expect = v + 1;
+    }
+    producer.join();
+    auto t1 = std::chrono::steady_clock::now();
+
+    char msg[112];
+    snprintf(msg, sizeof(msg), "spsc: %.1f M items/s across threads, producer found it full %u times",
+             N / std::chrono::duration<double>(t1 - t0).count() / 1e6, (unsigned)fullPushes);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL(0, outOfOrder);
+    TEST_ASSERT_TRUE(sum == (uint64_t)N * (N + 1) / 2);
+    TEST_ASSERT_EQUAL(0, q.size());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_seqlock_single_thread);
+    RUN_TEST(test_seqlock_readers_never_tear);
+    RUN_TEST(test_spsc_full_and_empty);
+    RUN_TEST(test_spsc_keeps_order_under_load);
+    return UNITY_END();
+}
@@ -0,0 +1,196 @@
+#include <unity.h>
+#include "i2c_worker.h"
+
+// The worker task is not started on the host, runQueued() stands in for it
+// and executes the queue against the mock TwoWire.
+
+#define ADDR        0x74
+#define ABSENT      0x70
+#define OUT1        2       // OUTPUT_PORT1
+
+static TwoWire   *bus;
+static I2CWorker *worker;
+
+struct Done {
+    uint8_t calls;
+    uint8_t status;
+    uint8_t data[I2C_MAX_DATA];
+};
+static Done done[I2C_QUEUE_LEN + 2];
+
+static void onDone(const I2CTransaction &t, void *ctx) {
+    Done &d = *static_cast<Done *>(ctx);
+    d.calls++;
+    d.status = t.status;
+    memcpy(d.data, t.data, t.len);
+}
+
+void setUp() {
+    bus = new TwoWire();
+    bus->attach(ADDR);
+    worker = new I2CWorker();
+    worker->begin(*bus, -1, -1);
+    memset(done, 0, sizeof(done));
+}
+void tearDown() {
+    delete worker;
+    delete bus;
+}
+
+static bool write16(uint16_t v, Done *d = &done[0], uint8_t reg = OUT1, bool verify = false) {
+    uint8_t b[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+    return worker->submitWrite(ADDR, reg, b, 2, onDone, d, verify);
+}
+
+// Later writes to a queued register only replace its data, one transfer
+// carries the last value
+static void test_queued_writes_coalesce() {
+    for (uint16_t v = 1; v <= 5; v++) TEST_ASSERT_TRUE(write16(v));
+    TEST_ASSERT_EQUAL(1, worker->outstanding());
+    TEST_ASSERT_EQUAL(4, worker->coalesced());
+
+    worker->runQueued();
+    worker->poll();
+    TEST_ASSERT_EQUAL(1, bus->transactions);
+    TEST_ASSERT_EQUAL(1, done[0].calls);
+    TEST_ASSERT_EQUAL(5, bus->dev[ADDR].regs[OUT1]);
+    TEST_ASSERT_EQUAL(0, worker->outstanding());
+}
+
+static void test_different_writes_do_not_coalesce() {
+    TEST_ASSERT_TRUE(write16(1));
+    TEST_ASSERT_TRUE(write16(2, &done[0], OUT1 + 4));      // another register
+    TEST_ASSERT_TRUE(write16(3, &done[1]));                 // another context
+    TEST_ASSERT_TRUE(write16(4, &done[0], OUT1, true));     // verified
+    TEST_ASSERT_TRUE(worker->submitRead(ADDR, OUT1, 2, onDone, &done[0]));
+    uint8_t b = 5;
+    TEST_ASSERT_TRUE(worker->submitWrite(ADDR, OUT1, &b, 1, onDone, &done[0]));  // shorter
+    TEST_ASSERT_EQUAL(6, worker->outstanding());
+    TEST_ASSERT_EQUAL(0, worker->coalesced());
+
+    // a write already on the bus is not changed either
+    worker->runQueued();
+    TEST_ASSERT_TRUE(write16(6));
+    TEST_ASSERT_EQUAL(7, worker->outstanding());
+    TEST_ASSERT_EQUAL(0, worker->coalesced());
+}
+
+// All 16 slots are held until poll() hands them back, also the finished ones
+static void test_queue_overflow() {
+    for (uint8_t i = 0; i < I2C_QUEUE_LEN; i++) TEST_ASSERT_TRUE(write16(i, &done[i]));
+    TEST_ASSERT_EQUAL(I2C_QUEUE_LEN, worker->outstanding());
+    TEST_ASSERT_FALSE(write16(99, &done[I2C_QUEUE_LEN]));
+    TEST_ASSERT_FALSE(worker->submitRead(ADDR, OUT1, 2, onDone, &done[I2C_QUEUE_LEN]));
+    TEST_ASSERT_EQUAL(2, worker->rejected());
+
+    // a full queue still takes a write it can coalesce
+    TEST_ASSERT_TRUE(write16(100, &done[3]));
+    TEST_ASSERT_EQUAL(1, worker->coalesced());
+
+    worker->runQueued();
+    TEST_ASSERT_EQUAL(I2C_QUEUE_LEN, bus->transactions);
+    TEST_ASSERT_FALSE(write16(99, &done[I2C_QUEUE_LEN]));
+    TEST_ASSERT_EQUAL(3, worker->rejected());
+    TEST_ASSERT_EQUAL(0, done[0].calls);
+
+    worker->poll();
+    TEST_ASSERT_EQUAL(0, worker->outstanding());
+    for (uint8_t i = 0; i < I2C_QUEUE_LEN; i++) TEST_ASSERT_EQUAL(1, done[i].calls);
+    TEST_ASSERT_EQUAL(100, done[3].data[0]);
+
+    // and the ring wraps
+    for (uint8_t i = 0; i < I2C_QUEUE_LEN; i++) TEST_ASSERT_TRUE(write16(i, &done[i]));
+    worker->runQueued();
+    worker->poll();
+    TEST_ASSERT_EQUAL(2, done[I2C_QUEUE_LEN - 1].calls);
+    TEST_ASSERT_EQUAL(3, worker->rejected());
+}
+
+static void test_retries() {
+    bus->failNext = I2C_RETRIES;
+    write16(0x1234);
+    worker->runQueued();
+    worker->poll();
+    TEST_ASSERT_EQUAL(0, done[0].status);
+    TEST_ASSERT_EQUAL(0x34, bus->dev[ADDR].regs[OUT1]);
+    const I2CDeviceStats &s = worker->deviceStats(0);
+    TEST_ASSERT_EQUAL(ADDR, s.addr);
+    TEST_ASSERT_EQUAL(1, s.transactions);
+    TEST_ASSERT_EQUAL(I2C_RETRIES, s.retries);
+    TEST_ASSERT_EQUAL(0, s.errors);
+
+    // the backoff doubles: 1 + 2 + 4 ms
+    TEST_ASSERT_TRUE(s.lastLatencyUs >= 7000);
+}
+
+static void test_failure_recovers_bus() {
+    worker->begin(*bus, 1, 2);
+    bus->failNext = I2C_RETRIES + 1;
+    write16(0x1234);
+    worker->runQueued();
+    worker->poll();
+    TEST_ASSERT_EQUAL(5, done[0].status);
+    TEST_ASSERT_EQUAL(1, worker->recoveries());
+    TEST_ASSERT_EQUAL(1, worker->deviceStats(0).errors);
+
+    // a device that does not answer is not a bus fault
+    uint8_t b = 0;
+    worker->submitWrite(ABSENT, OUT1, &b, 1, onDone, &done[1]);
+    worker->runQueued();
+    worker->poll();
+    TEST_ASSERT_EQUAL(2, done[1].status);
+    TEST_ASSERT_EQUAL(1, worker->recoveries());
+    TEST_ASSERT_EQUAL(2, worker->deviceCount());
+}
+
+static void test_verify() {
+    TEST_ASSERT_TRUE(write16(0x00f0, &done[0], OUT1, true));
+    worker->runQueued();
+    worker->poll();
+    TEST_ASSERT_EQUAL(0, done[0].status);
+    TEST_ASSERT_EQUAL(2, bus->transactions);                // write and read-back
+
+    // a pin that does not follow the write
+    bus->dev[ADDR].stuckBits = 0x01;
+    bus->dev[ADDR].regs[OUT1] = 0x00;
+    TEST_ASSERT_TRUE(write16(0x00f1, &done[0], OUT1, true));
+    worker->runQueued();
+    worker->poll();
+    TEST_ASSERT_EQUAL(I2C_ERR_VERIFY, done[0].status);
+    const I2CDeviceStats &s = worker->deviceStats(0);
+    TEST_ASSERT_EQUAL(I2C_RETRIES, s.verifyFailures);       // the last attempt is an error
+    TEST_ASSERT_EQUAL(1, s.errors);
+}
+
+// A relay word rewritten every millisecond while the worker only gets to
+// run every 10 ms
+static void test_coalescing_saves_transfers() {
+    uint32_t submitted = 0;
+    for (uint16_t ms = 0; ms < 1000; ms++) {
+        write16(ms);
+        submitted++;
+        if (ms % 10 == 9) {
+            worker->runQueued();
+            worker->poll();
+        }
+    }
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%u writes submitted, %u bus transactions, %u coalesced",
+             (unsigned)submitted, (unsigned)bus->transactions, (unsigned)worker->coalesced());
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL(100, bus->transactions);
+    TEST_ASSERT_EQUAL(900, worker->coalesced());
+    TEST_ASSERT_EQUAL(0, worker->rejected());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_queued_writes_coalesce);
+    RUN_TEST(test_different_writes_do_not_coalesce);
+    RUN_TEST(test_queue_overflow);
+    RUN_TEST(test_retries);
+    RUN_TEST(test_failure_recovers_bus);
+    RUN_TEST(test_verify);
+    RUN_TEST(test_coalescing_saves_transfers);
+    return UNITY_END();
+}
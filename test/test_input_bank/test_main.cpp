@@ -0,0 +1,159 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "input_bank.h"
+
+#define BUTTON  (1u << 8)
+#define SWITCH  (1u << 3)
+
+static InputBank bank;
+
+void setUp() {
+    bank.begin(0, BUTTON, 200, 20);
+}
+void tearDown() {}
+
+// feeds a scripted bounce pattern for the given inputs, returns the tick of
+// the last press and counts presses and releases
+static int play(const uint8_t *pattern, int len, uint32_t mask, int *presses, int *releases) {
+    int at = -1;
+    for (int k = 0; k < len; k++) {
+        const InputEvents &e = bank.tick(pattern[k] ? mask : 0);
+        if (e.pressed & mask) {
+            (*presses)++;
+            at = k;
+        }
+        if (e.released & mask) (*releases)++;
+    }
+    return at;
+}
+
+static void test_press_bounce() {
+    const uint8_t bounce[] = { 1, 0, 1, 1, 0, 1, 1, 1, 1 };
+    int presses = 0, releases = 0;
+    int at = play(bounce, sizeof(bounce), BUTTON | SWITCH, &presses, &releases);
+    TEST_ASSERT_EQUAL(1, presses);
+    TEST_ASSERT_EQUAL(0, releases);
+    TEST_ASSERT_EQUAL(8, at);                       // four agreeing samples after the last bounce
+    TEST_ASSERT_EQUAL(BUTTON | SWITCH, bank.state());
+}
+
+static void test_glitches_are_ignored() {
+    const uint8_t on[] = { 1, 1, 1, 1 };
+    int presses = 0, releases = 0;
+    play(on, sizeof(on), BUTTON, &presses, &releases);
+
+    // single-sample and three-sample dropouts never release
+    const uint8_t glitch[] = { 0, 1, 1, 0, 0, 0, 1, 1, 0, 1, 0, 0, 1 };
+    play(glitch, sizeof(glitch), BUTTON, &presses, &releases);
+    TEST_ASSERT_EQUAL(1, presses);
+    TEST_ASSERT_EQUAL(0, releases);
+
+    const uint8_t release[] = { 0, 1, 0, 0, 0, 0 };
+    int at = play(release, sizeof(release), BUTTON, &presses, &releases);
+    TEST_ASSERT_EQUAL(1, releases);
+    TEST_ASSERT_EQUAL(-1, at);
+    TEST_ASSERT_EQUAL(0, bank.state());
+}
+
+static void test_inputs_are_independent() {
+    uint32_t pressed = 0;
+    for (int k = 0; k < 4; k++) pressed |= bank.tick(k & 1 ? SWITCH : BUTTON).pressed;
+    TEST_ASSERT_EQUAL(0, pressed);                  // both alternate, neither settles
+    for (int k = 0; k < 4; k++) pressed |= bank.tick(SWITCH).pressed;
+    TEST_ASSERT_EQUAL(SWITCH, pressed);
+}
+
+static void test_long_press_and_repeat() {
+    for (int k = 0; k < 3; k++) bank.tick(BUTTON | SWITCH);
+    TEST_ASSERT_EQUAL(BUTTON, bank.tick(BUTTON | SWITCH).pressed & BUTTON);
+
+    int longPresses = 0, held = 0, longAt = 0;
+    for (int k = 1; k <= 300; k++) {
+        const InputEvents &e = bank.tick(BUTTON | SWITCH);
+        if (e.longPress) {
+            longPresses++;
+            longAt = k;
+            TEST_ASSERT_EQUAL(BUTTON, e.longPress);  // the switch is not in the hold mask
+        }
+        if (e.held) held++;
+    }
+    TEST_ASSERT_EQUAL(1, longPresses);
+    TEST_ASSERT_EQUAL(199, longAt);                 // 200 ticks including the press
+    TEST_ASSERT_EQUAL((300 - 199) / 20, held);
+
+    // a new press starts the hold time over
+    for (int k = 0; k < 4; k++) bank.tick(0);
+    longPresses = 0;
+    for (int k = 0; k < 210; k++) {
+        if (bank.tick(BUTTON).longPress) longPresses++;
+    }
+    TEST_ASSERT_EQUAL(1, longPresses);
+}
+
+static void test_hold_disabled() {
+    bank.begin(BUTTON, BUTTON);
+    for (int k = 0; k < 1000; k++) {
+        const InputEvents &e = bank.tick(BUTTON);
+        TEST_ASSERT_EQUAL(0, e.pressed | e.longPress | e.held);
+    }
+    TEST_ASSERT_EQUAL(BUTTON, bank.state());
+}
+
+// Per-tick cost with nine bouncing inputs, against a per-input counter loop
+// over the same samples
+static void test_benchmark_tick() {
+    const int N = 10000000;
+    static uint32_t samples[4096];
+    srand(3);
+    for (uint32_t &s : samples) s = rand() & 0x1ff;
+    uint32_t acc = 0;
+
+    InputBank hold;
+    hold.begin(0, 0x1ff, 200, 20);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < N; k++) acc += hold.tick(samples[k & 4095]).pressed;
+    auto t1 = std::chrono::steady_clock::now();
+
+    InputBank plain;
+    plain.begin(0);
+    for (int k = 0; k < N; k++) acc += plain.tick(samples[k & 4095]).pressed;
+    auto t2 = std::chrono::steady_clock::now();
+
+    uint8_t count[9] = {};
+    uint32_t state = 0;
+    for (int k = 0; k < N; k++) {
+        uint32_t s = samples[k & 4095];
+        for (uint8_t i = 0; i < 9; i++) {
+            if (((s ^ state) >> i) & 1) {
+                if (++count[i] == INPUT_DEBOUNCE_TICKS) {
+                    state ^= 1u << i;
+                    count[i] = 0;
+                    acc += (state >> i) & 1;
+                }
+            } else {
+                count[i] = 0;
+            }
+        }
+    }
+    auto t3 = std::chrono::steady_clock::now();
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "tick: %.2f ns with hold tracking, %.2f ns debounce only, %.2f ns per-input loop (%u)",
+             std::chrono::duration<double, std::nano>(t1 - t0).count() / N,
+             std::chrono::duration<double, std::nano>(t2 - t1).count() / N,
+             std::chrono::duration<double, std::nano>(t3 - t2).count() / N, (unsigned)(acc & 1));
+    TEST_MESSAGE(msg);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_press_bounce);
+    RUN_TEST(test_glitches_are_ignored);
+    RUN_TEST(test_inputs_are_independent);
+    RUN_TEST(test_long_press_and_repeat);
+    RUN_TEST(test_hold_disabled);
+    RUN_TEST(test_benchmark_tick);
+    return UNITY_END();
+}
@@ -0,0 +1,212 @@
+#include <unity.h>
+#include "ioex_bus.h"
+
+// Four expanders, 0x74/0x75 on one bus and 0x76/0x77 on the other, like the
+// relay boards. The workers are stepped with runQueued() and poll().
+
+#define OUT1    2       // OUTPUT_PORT1
+#define CFG1    6       // CONFIG1
+
+static const uint8_t  ADDR[4]   = { 0x74, 0x75, 0x76, 0x77 };
+static const uint16_t INPUTS[4] = { 0, 0, 0, 0xff00 };
+
+static TwoWire   *wire[2];
+static I2CWorker *worker[2];
+static IoExBus   *bus;
+
+static TwoWire::Expander &expander(uint8_t device) {
+    return wire[device / 2]->dev[ADDR[device]];
+}
+
+// the workers run their queues and loop() picks up the results
+static void step() {
+    for (uint8_t b = 0; b < 2; b++) worker[b]->runQueued();
+    for (uint8_t b = 0; b < 2; b++) worker[b]->poll();
+}
+
+void setUp() {
+    bus = new IoExBus();
+    for (uint8_t b = 0; b < 2; b++) {
+        wire[b]   = new TwoWire();
+        worker[b] = new I2CWorker();
+        worker[b]->begin(*wire[b], -1, -1);
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        wire[i / 2]->attach(ADDR[i]);
+        TEST_ASSERT_EQUAL(i, bus->addDevice(*wire[i / 2], *worker[i / 2], ADDR[i], INPUTS[i]));
+    }
+    TEST_ASSERT_TRUE(bus->begin());
+    for (uint8_t b = 0; b < 2; b++) wire[b]->resetCounters();
+}
+void tearDown() {
+    delete bus;
+    for (uint8_t b = 0; b < 2; b++) {
+        delete worker[b];
+        delete wire[b];
+    }
+}
+
+static void test_begin() {
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, expander(i).regs[OUT1]);
+        TEST_ASSERT_EQUAL(0, expander(i).regs[OUT1 + 1]);
+        TEST_ASSERT_EQUAL((uint8_t)INPUTS[i], expander(i).regs[CFG1]);
+        TEST_ASSERT_EQUAL(INPUTS[i] >> 8, expander(i).regs[CFG1 + 1]);
+    }
+    TEST_ASSERT_EQUAL(1, bus->commitResult());
+}
+
+static void test_flat_pins() {
+    TEST_ASSERT_EQUAL(4, bus->devices());
+    TEST_ASSERT_EQUAL(64, bus->pinCount());
+
+    bus->setPin(0, true);
+    bus->setPin(17, true);
+    bus->setPin(40, true);
+    bus->setPin(63, true);
+    bus->setPin(64, true);                      // past the last device
+    TEST_ASSERT_EQUAL_HEX16(0x0001, bus->word(0));
+    TEST_ASSERT_EQUAL_HEX16(0x0002, bus->word(1));
+    TEST_ASSERT_EQUAL_HEX16(0x0100, bus->word(2));
+    TEST_ASSERT_EQUAL_HEX16(0x8000, bus->word(3));
+    TEST_ASSERT_TRUE(bus->pin(17));
+    TEST_ASSERT_FALSE(bus->pin(16));
+    TEST_ASSERT_FALSE(bus->pin(64));
+
+    bus->setPin(17, false);
+    TEST_ASSERT_EQUAL_HEX16(0, bus->word(1));
+
+    TEST_ASSERT_TRUE(bus->commit());
+    step();
+    TEST_ASSERT_EQUAL(0x01, expander(0).regs[OUT1]);
+    TEST_ASSERT_EQUAL(0x01, expander(2).regs[OUT1 + 1]);
+    TEST_ASSERT_EQUAL(0x80, expander(3).regs[OUT1 + 1]);
+}
+
+// any number of pin changes cost one verified write per changed device
+static void test_one_write_per_dirty_device() {
+    for (uint16_t p = 0; p < 16; p++) bus->setPin(p, true);
+    bus->setPin(33, true);
+    bus->setPin(34, true);
+    bus->setPin(35, true);
+
+    TEST_ASSERT_TRUE(bus->commit());
+    TEST_ASSERT_EQUAL(2, bus->transactions());
+    TEST_ASSERT_EQUAL(1, worker[0]->outstanding());
+    TEST_ASSERT_EQUAL(1, worker[1]->outstanding());
+    TEST_ASSERT_EQUAL(0, bus->commitResult());
+
+    worker[0]->runQueued();
+    worker[1]->runQueued();
+    TEST_ASSERT_EQUAL(0, bus->commitResult());  // not before poll()
+    worker[0]->poll();
+    TEST_ASSERT_EQUAL(1, bus->commitResult(0));
+    TEST_ASSERT_EQUAL(0, bus->commitResult(2));
+    worker[1]->poll();
+    TEST_ASSERT_EQUAL(1, bus->commitResult());
+
+    const uint8_t writes[4] = { 1, 0, 1, 0 };
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(writes[i], expander(i).writes);
+        TEST_ASSERT_EQUAL(writes[i], expander(i).reads);     // the read-back
+    }
+    TEST_ASSERT_EQUAL(0xff, expander(0).regs[OUT1]);
+    TEST_ASSERT_EQUAL(0xff, expander(0).regs[OUT1 + 1]);
+    TEST_ASSERT_EQUAL(0x0e, expander(2).regs[OUT1]);
+
+    // nothing changed, nothing sent
+    TEST_ASSERT_TRUE(bus->commit());
+    TEST_ASSERT_EQUAL(0, worker[0]->outstanding() + worker[1]->outstanding());
+    TEST_ASSERT_EQUAL(2, bus->transactions());
+}
+
+// A pin that reads back wrong fails its device only, the next commit
+// rewrites the directions and the outputs
+static void test_verify_mismatch() {
+    expander(3).stuckBits = 0x01;
+    bus->setPin(0, true);
+    bus->setPin(48, true);
+    TEST_ASSERT_TRUE(bus->commit());
+    step();
+    TEST_ASSERT_EQUAL(-1, bus->commitResult());
+    TEST_ASSERT_EQUAL(-1, bus->commitResult(3));
+    TEST_ASSERT_EQUAL(1, bus->commitResult(0));
+    TEST_ASSERT_EQUAL(1, bus->commitResult(1));
+    TEST_ASSERT_EQUAL(ADDR[3], worker[1]->deviceStats(0).addr);
+    TEST_ASSERT_EQUAL(I2C_RETRIES, worker[1]->deviceStats(0).verifyFailures);
+
+    // the expander was reset meanwhile
+    expander(3).stuckBits = 0;
+    expander(3).regs[CFG1 + 1] = 0x00;
+    expander(3).writes = 0;
+
+    TEST_ASSERT_TRUE(bus->commit());            // only device 3 is dirty
+    TEST_ASSERT_EQUAL(0, worker[0]->outstanding());
+    TEST_ASSERT_EQUAL(2, worker[1]->outstanding());
+    TEST_ASSERT_EQUAL(0, bus->commitResult(3));
+    step();
+    TEST_ASSERT_EQUAL(1, bus->commitResult());
+    TEST_ASSERT_EQUAL(2, expander(3).writes);   // CONFIG, then OUTPUT
+    TEST_ASSERT_EQUAL(0xff, expander(3).regs[CFG1 + 1]);
+    TEST_ASSERT_EQUAL(0x01, expander(3).regs[OUT1]);
+
+    // the directions are written once
+    bus->setPin(49, true);
+    TEST_ASSERT_TRUE(bus->commit());
+    TEST_ASSERT_EQUAL(1, worker[1]->outstanding());
+    step();
+    TEST_ASSERT_EQUAL(3, expander(3).writes);
+    TEST_ASSERT_EQUAL(1, bus->commitResult());
+}
+
+// A failure of one device that comes back after a later commit of another
+// device does not fail that one
+static void test_failure_stays_with_its_device() {
+    bus->setPin(16, true);
+    TEST_ASSERT_TRUE(bus->commit());
+    bus->setPin(32, true);
+    TEST_ASSERT_TRUE(bus->commit());
+    wire[0]->failNext = I2C_RETRIES + 1;
+    step();
+    TEST_ASSERT_EQUAL(-1, bus->commitResult(1));
+    TEST_ASSERT_EQUAL(1, bus->commitResult(2));
+    TEST_ASSERT_EQUAL(-1, bus->commitResult());
+
+    // the next commit sends device 1 again
+    TEST_ASSERT_TRUE(bus->commit());
+    TEST_ASSERT_EQUAL(2, worker[0]->outstanding());        // CONFIG and OUTPUT
+    TEST_ASSERT_EQUAL(0, worker[1]->outstanding());
+    step();
+    TEST_ASSERT_EQUAL(1, bus->commitResult());
+    TEST_ASSERT_EQUAL(0x01, expander(1).regs[OUT1]);
+}
+
+// a full worker queue rejects the write, the device reports the error
+static void test_queue_full() {
+    for (uint8_t i = 0; i < I2C_QUEUE_LEN; i++) {
+        TEST_ASSERT_TRUE(worker[1]->submitRead(ADDR[2], i & 7, 1, NULL));
+    }
+    bus->setPin(0, true);
+    bus->setPin(32, true);
+    TEST_ASSERT_FALSE(bus->commit());
+    TEST_ASSERT_EQUAL(-1, bus->commitResult(2));
+    TEST_ASSERT_EQUAL(0, bus->commitResult(0));
+
+    // once the queue drains the next commit sends it
+    step();
+    TEST_ASSERT_TRUE(bus->commit());
+    step();
+    TEST_ASSERT_EQUAL(1, bus->commitResult());
+    TEST_ASSERT_EQUAL(0x01, expander(2).regs[OUT1]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_begin);
+    RUN_TEST(test_flat_pins);
+    RUN_TEST(test_one_write_per_dirty_device);
+    RUN_TEST(test_verify_mismatch);
+    RUN_TEST(test_failure_stays_with_its_device);
+    RUN_TEST(test_queue_full);
+    return UNITY_END();
+}
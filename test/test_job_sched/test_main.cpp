@@ -0,0 +1,136 @@
+#include <unity.h>
+#include "job_sched.h"
+
+// runDue() takes the time in ms, the jobs are timed with the mock micros(),
+// which a job moves forward by how long it pretends to run.
+
+static JobScheduler *sched;
+static char     order[64];
+static uint8_t  orderLen;
+static uint32_t runTimeUs;
+
+// logs its tag and runs for runTimeUs
+static void job(void *ctx) {
+    if (orderLen < sizeof(order) - 1) order[orderLen++] = *static_cast<char *>(ctx);
+    mockAdvance(runTimeUs);
+}
+
+void setUp() {
+    sched = new JobScheduler();
+    orderLen  = 0;
+    runTimeUs = 10;
+    memset(order, 0, sizeof(order));
+}
+void tearDown() {
+    delete sched;
+}
+
+static void test_release_order() {
+    char a = 'a', b = 'b', c = 'c';
+    TEST_ASSERT_TRUE(sched->add("a", job, &a, 10, 1000));
+    TEST_ASSERT_TRUE(sched->add("b", job, &b, 20, 1000));
+    TEST_ASSERT_TRUE(sched->add("c", job, &c, 5, 1000));
+
+    // all are released on the first call, in the order they were added
+    TEST_ASSERT_EQUAL(5, sched->runDue(1000));
+    for (uint32_t t = 1001; t <= 1040; t++) sched->runDue(t);
+    TEST_ASSERT_EQUAL_STRING("abc" "c" "ac" "c" "abc" "c" "ac" "c" "abc", order);
+
+    TEST_ASSERT_EQUAL(5, sched->stats(0).runs);
+    TEST_ASSERT_EQUAL(3, sched->stats(1).runs);
+    TEST_ASSERT_EQUAL(9, sched->stats(2).runs);
+    TEST_ASSERT_EQUAL(0, sched->stats(0).maxLateMs);
+
+    // the time to the next release, when no job is due
+    TEST_ASSERT_EQUAL(4, sched->runDue(1041));
+    TEST_ASSERT_EQUAL(1, sched->runDue(1044));
+}
+
+static void test_full_table() {
+    char j = 'j';
+    for (uint8_t i = 0; i < SCHED_MAX_JOBS; i++) TEST_ASSERT_TRUE(sched->add("j", job, &j, 10, 100));
+    TEST_ASSERT_FALSE(sched->add("j", job, &j, 10, 100));
+    TEST_ASSERT_EQUAL(SCHED_MAX_JOBS, sched->jobCount());
+
+    JobScheduler empty;
+    TEST_ASSERT_EQUAL(0, empty.runDue(0));
+}
+
+static void test_late_start_keeps_phase() {
+    char a = 'a';
+    sched->add("a", job, &a, 10, 1000);
+    sched->runDue(0);
+    TEST_ASSERT_EQUAL(8, sched->runDue(12));        // 2 ms late, next at 20
+    TEST_ASSERT_EQUAL(2, sched->stats(0).runs);
+    TEST_ASSERT_EQUAL(2, sched->stats(0).maxLateMs);
+    TEST_ASSERT_EQUAL(0, sched->stats(0).missed);
+}
+
+// a whole period late: the missed releases are skipped, not run back to back
+static void test_missed_releases_are_skipped() {
+    char a = 'a';
+    sched->add("a", job, &a, 10, 1000);
+    sched->runDue(0);
+    TEST_ASSERT_EQUAL(10, sched->runDue(35));       // due at 10, 25 late
+    TEST_ASSERT_EQUAL(2, sched->stats(0).runs);
+    TEST_ASSERT_EQUAL(2, sched->stats(0).missed);   // 20 and 30
+    TEST_ASSERT_EQUAL(25, sched->stats(0).maxLateMs);
+
+    // exactly one period late counts as one missed release
+    TEST_ASSERT_EQUAL(10, sched->runDue(55));
+    TEST_ASSERT_EQUAL(3, sched->stats(0).missed);
+    TEST_ASSERT_EQUAL(10, sched->runDue(65));
+    TEST_ASSERT_EQUAL(4, sched->stats(0).runs);
+}
+
+static void test_budget_overruns() {
+    char a = 'a';
+    sched->add("a", job, &a, 1, 100);
+    const uint32_t took[] = { 50, 150, 100, 101, 20 };
+    for (uint8_t i = 0; i < 5; i++) {
+        runTimeUs = took[i];
+        sched->runDue(i);
+    }
+    const JobStats &s = sched->stats(0);
+    TEST_ASSERT_EQUAL(5, s.runs);
+    TEST_ASSERT_EQUAL(2, s.overruns);               // 150 and 101, the budget itself is fine
+    TEST_ASSERT_EQUAL(150, s.maxUs);
+    TEST_ASSERT_EQUAL(20, s.lastUs);
+}
+
+static void test_histogram() {
+    char a = 'a';
+    sched->add("a", job, &a, 1, 0xffff);
+    const uint32_t took[] = { 10, 49, 50, 99, 100, 1999, 2000, 4999, 5000, 60000 };
+    const uint32_t want[SCHED_HIST_BUCKETS] = { 2, 2, 1, 0, 0, 1, 2, 2 };
+    for (uint8_t i = 0; i < sizeof(took) / sizeof(took[0]); i++) {
+        runTimeUs = took[i];
+        sched->runDue(i);
+    }
+    for (uint8_t b = 0; b < SCHED_HIST_BUCKETS; b++) TEST_ASSERT_EQUAL(want[b], sched->stats(0).hist[b]);
+
+    TEST_ASSERT_EQUAL(50, JobScheduler::histogramBound(0));
+    TEST_ASSERT_EQUAL(5000, JobScheduler::histogramBound(SCHED_HIST_BUCKETS - 2));
+    TEST_ASSERT_EQUAL(0xffff, JobScheduler::histogramBound(SCHED_HIST_BUCKETS - 1));
+}
+
+static void test_millis_wrap() {
+    char a = 'a';
+    sched->add("a", job, &a, 10, 1000);
+    uint32_t t = 0xffffffff - 14;
+    for (uint32_t i = 0; i <= 30; i++) sched->runDue(t + i);
+    TEST_ASSERT_EQUAL(4, sched->stats(0).runs);
+    TEST_ASSERT_EQUAL(0, sched->stats(0).missed);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_release_order);
+    RUN_TEST(test_full_table);
+    RUN_TEST(test_late_start_keeps_phase);
+    RUN_TEST(test_missed_releases_are_skipped);
+    RUN_TEST(test_budget_overruns);
+    RUN_TEST(test_histogram);
+    RUN_TEST(test_millis_wrap);
+    return UNITY_END();
+}
@@ -0,0 +1,176 @@
+#include <unity.h>
+#include "relay_seq.h"
+
+// Simulated relay driver: writes land at once, the read-back is scripted
+static uint16_t outputs;
+static int      writes;
+static bool     writeFails;
+static int8_t   confirmResult;      // 0 = not yet, -1 = error, 1 = as written
+static bool     stuckOpen;          // a released read-back, never the energised one
+static bool     interlock;
+
+static bool simWrite(uint16_t mask) {
+    writes++;
+    if (writeFails) return false;
+    outputs = mask;
+    return true;
+}
+
+static int8_t simConfirm(uint16_t mask) {
+    if (confirmResult <= 0) return confirmResult;
+    if (stuckOpen && mask) return 0;
+    return outputs == mask ? 1 : -1;
+}
+
+static bool simInterlock() {
+    return interlock;
+}
+
+static RelaySequencer seq;
+static uint32_t now;
+
+void setUp() {
+    outputs       = 0;
+    writes        = 0;
+    writeFails    = false;
+    confirmResult = 1;
+    stuckOpen     = false;
+    interlock     = true;
+    now           = 1000;
+    seq.begin({ simWrite, simConfirm, simInterlock }, 20);
+}
+void tearDown() {}
+
+// runs update() every ms for up to ms, returns how often current() changed
+static int run(uint32_t ms) {
+    int changes = 0;
+    for (uint32_t i = 0; i < ms; i++, now++) {
+        if (seq.update(now)) changes++;
+    }
+    return changes;
+}
+
+static void test_break_before_make() {
+    seq.request(3, now);
+    TEST_ASSERT_TRUE(seq.busy());
+    run(100);
+    TEST_ASSERT_EQUAL(RelaySequencer::State::IDLE, seq.state());
+    TEST_ASSERT_EQUAL(3, seq.current());
+    TEST_ASSERT_EQUAL(RELAY_DIR_MASK(3), outputs);
+    TEST_ASSERT_EQUAL(2, writes);                       // release, energise
+
+    seq.request(5, now);
+    seq.update(now);                                    // RELEASE
+    TEST_ASSERT_EQUAL(0, outputs);
+    uint32_t released = now;
+    while (outputs == 0 && now - released < 100) seq.update(++now);
+    TEST_ASSERT_EQUAL(RELAY_DIR_MASK(5), outputs);
+    TEST_ASSERT_GREATER_OR_EQUAL(20, now - released);   // settle time respected
+    run(10);
+    TEST_ASSERT_EQUAL(5, seq.current());
+}
+
+static void test_interlock_holds_off() {
+    interlock = false;
+    seq.request(2, now);
+    run(500);
+    TEST_ASSERT_EQUAL(0, writes);                       // nothing touched under RF
+    TEST_ASSERT_EQUAL(RelaySequencer::State::RELEASE, seq.state());
+
+    interlock = true;
+    run(100);
+    TEST_ASSERT_EQUAL(2, seq.current());
+}
+
+static void test_retarget_before_energise() {
+    seq.request(1, now);
+    run(5);                                             // settling
+    seq.request(6, now);
+    run(100);
+    TEST_ASSERT_EQUAL(6, seq.current());
+    TEST_ASSERT_EQUAL(2, writes);                       // 1 was never energised
+}
+
+static void test_confirm_timeout_faults() {
+    seq.setConfirmTime(80);
+    stuckOpen = true;
+    seq.request(4, now);
+    while (seq.state() != RelaySequencer::State::CONFIRM && now < 2000) seq.update(++now);
+    TEST_ASSERT_EQUAL(RELAY_DIR_MASK(4), outputs);      // energised, never reads back
+    run(80);
+    TEST_ASSERT_EQUAL(RelaySequencer::State::CONFIRM, seq.state());
+    run(1);
+    TEST_ASSERT_EQUAL(RelaySequencer::State::FAULT, seq.state());
+    TEST_ASSERT_FALSE(seq.busy());
+    TEST_ASSERT_EQUAL(1, seq.faults());
+}
+
+static void test_fault_retries_after_backoff() {
+    writeFails = true;
+    seq.request(7, now);
+    seq.update(now);
+    TEST_ASSERT_EQUAL(RelaySequencer::State::FAULT, seq.state());
+
+    writeFails = false;
+    run(RELAY_RETRY_MS - 1);
+    TEST_ASSERT_EQUAL(RelaySequencer::State::FAULT, seq.state());
+    run(100);
+    TEST_ASSERT_EQUAL(RelaySequencer::State::IDLE, seq.state());
+    TEST_ASSERT_EQUAL(7, seq.current());
+}
+
+static void test_fault_retry_on_demand() {
+    writeFails = true;
+    seq.request(7, now);
+    seq.update(now);
+    writeFails = false;
+
+    // the same direction again restarts it, as does retry()
+    seq.request(7, now);
+    TEST_ASSERT_TRUE(seq.busy());
+    run(100);
+    TEST_ASSERT_EQUAL(7, seq.current());
+
+    writeFails = true;
+    seq.request(2, now);
+    run(2);
+    TEST_ASSERT_EQUAL(RelaySequencer::State::FAULT, seq.state());
+    writeFails = false;
+    seq.retry(now);
+    run(100);
+    TEST_ASSERT_EQUAL(2, seq.current());
+    seq.retry(now);                                     // no-op outside FAULT
+    TEST_ASSERT_EQUAL(RelaySequencer::State::IDLE, seq.state());
+}
+
+static void test_latency_histogram() {
+    uint32_t before = 0;
+    for (uint8_t b = 0; b < RELAY_HIST_BUCKETS; b++) before += seq.histogram(b);
+    seq.request(8, now);
+    run(100);
+    uint32_t after = 0;
+    for (uint8_t b = 0; b < RELAY_HIST_BUCKETS; b++) after += seq.histogram(b);
+    TEST_ASSERT_EQUAL(before + 1, after);
+    TEST_ASSERT_GREATER_OR_EQUAL(20, seq.lastLatency());
+    TEST_ASSERT_LESS_THAN(50, seq.lastLatency());
+}
+
+static void test_deadlines_survive_millis_wrap() {
+    now = 0xffffffff - 10;
+    seq.request(3, now);
+    run(100);
+    TEST_ASSERT_EQUAL(3, seq.current());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_break_before_make);
+    RUN_TEST(test_interlock_holds_off);
+    RUN_TEST(test_retarget_before_energise);
+    RUN_TEST(test_confirm_timeout_faults);
+    RUN_TEST(test_fault_retries_after_backoff);
+    RUN_TEST(test_fault_retry_on_demand);
+    RUN_TEST(test_latency_histogram);
+    RUN_TEST(test_deadlines_survive_millis_wrap);
+    return UNITY_END();
+}
@@ -0,0 +1,111 @@
+#include <unity.h>
+#include "state_bcast.h"
+
+static StateBroadcaster bcast;
+static uint32_t now;
+
+void setUp() {
+    bcast = StateBroadcaster();
+    bcast.begin(BCAST_INTERVAL_MS, BCAST_HEARTBEAT_MS);
+    now = 10000;
+}
+void tearDown() {}
+
+// polls every ms with unchanged telemetry, returns the frames sent
+static int run(uint32_t ms) {
+    int sent = 0;
+    for (uint32_t i = 0; i < ms; i++, now++) {
+        if (bcast.poll(now, false)) sent++;
+    }
+    return sent;
+}
+
+static void test_first_change_goes_out_at_once() {
+    bcast.markDirty(now);
+    TEST_ASSERT_TRUE(bcast.poll(now, false));
+    TEST_ASSERT_EQUAL(0, bcast.lastStaleness());
+
+    // after a quiet interval the next change is not delayed either
+    run(BCAST_INTERVAL_MS + 50);
+    bcast.markDirty(now);
+    TEST_ASSERT_TRUE(bcast.poll(now, false));
+    TEST_ASSERT_EQUAL(2, bcast.frames());
+}
+
+static void test_burst_is_coalesced() {
+    bcast.markDirty(now);
+    TEST_ASSERT_TRUE(bcast.poll(now, false));
+    now++;
+
+    for (int i = 0; i < 20; i++) bcast.markDirty(now + i);
+    TEST_ASSERT_TRUE(bcast.dirty());
+    TEST_ASSERT_EQUAL(19, bcast.coalesced());
+
+    // held back until the interval since the last frame is over
+    TEST_ASSERT_EQUAL(0, run(BCAST_INTERVAL_MS - 1));
+    TEST_ASSERT_EQUAL(1, run(1));
+    TEST_ASSERT_EQUAL(BCAST_INTERVAL_MS - 1, bcast.lastStaleness());
+    TEST_ASSERT_FALSE(bcast.dirty());
+}
+
+// a change every ms for a second: one frame per interval, none stale for
+// longer than an interval
+static void test_change_storm_is_rate_limited() {
+    int sent = 0;
+    for (int i = 0; i < 1000; i++, now++) {
+        bcast.markDirty(now);
+        if (bcast.poll(now, false)) sent++;
+    }
+    TEST_ASSERT_EQUAL(1000 / BCAST_INTERVAL_MS, sent);
+    // every change but the first of each frame, the last one still pending
+    TEST_ASSERT_EQUAL(1000 - sent - 1, bcast.coalesced());
+    TEST_ASSERT_TRUE(bcast.maxStaleness() < BCAST_INTERVAL_MS);
+}
+
+static void test_heartbeat_skipped_when_unchanged() {
+    bcast.markDirty(now);
+    bcast.poll(now, false);
+
+    TEST_ASSERT_EQUAL(0, run(3 * BCAST_HEARTBEAT_MS + 1));
+    TEST_ASSERT_EQUAL(3, bcast.skippedBeats());
+    TEST_ASSERT_EQUAL(1, bcast.frames());
+}
+
+static void test_heartbeat_sends_changed_telemetry() {
+    bcast.markDirty(now);
+    bcast.poll(now, false);
+
+    // only looked at once a heartbeat is due
+    now += BCAST_HEARTBEAT_MS - 1;
+    TEST_ASSERT_FALSE(bcast.poll(now, true));
+    now++;
+    TEST_ASSERT_TRUE(bcast.poll(now, true));
+    TEST_ASSERT_EQUAL(0, bcast.skippedBeats());
+
+    // a state frame restarts the heartbeat period
+    now += BCAST_HEARTBEAT_MS / 2;
+    bcast.markDirty(now);
+    TEST_ASSERT_TRUE(bcast.poll(now, false));
+    now += BCAST_HEARTBEAT_MS - 1;
+    TEST_ASSERT_FALSE(bcast.poll(now, true));
+}
+
+static void test_millis_wrap() {
+    now = 0xffffffff - 20;
+    bcast.markDirty(now);
+    TEST_ASSERT_TRUE(bcast.poll(now, false));
+    bcast.markDirty(now + 1);
+    TEST_ASSERT_EQUAL(1, run(BCAST_INTERVAL_MS + 1));
+    TEST_ASSERT_TRUE(bcast.maxStaleness() < BCAST_INTERVAL_MS);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_change_goes_out_at_once);
+    RUN_TEST(test_burst_is_coalesced);
+    RUN_TEST(test_change_storm_is_rate_limited);
+    RUN_TEST(test_heartbeat_skipped_when_unchanged);
+    RUN_TEST(test_heartbeat_sends_changed_telemetry);
+    RUN_TEST(test_millis_wrap);
+    return UNITY_END();
+}
@@ -0,0 +1,155 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include "swr_calc.h"
+
+static PowerCurve fwdCurve, refCurve;
+
+void setUp() {
+    fwdCurve.load(SWR_FWD_CAL, SWR_FWD_CAL_POINTS);
+    refCurve.load(SWR_REF_CAL, SWR_REF_CAL_POINTS);
+}
+void tearDown() {}
+
+// float reference for the same piecewise-linear curve
+static double refMilliwatts(const CalPoint *pts, uint8_t n, uint16_t adc) {
+    if (adc <= pts[0].adc) return pts[0].mw;
+    if (adc >= pts[n - 1].adc) return pts[n - 1].mw;
+    uint8_t i = 0;
+    while (adc >= pts[i + 1].adc) i++;
+    return pts[i].mw + (double)(pts[i + 1].mw - pts[i].mw) * (adc - pts[i].adc) / (pts[i + 1].adc - pts[i].adc);
+}
+
+// the Q16 slope and the interpolation both truncate, so a reading is at most
+// just over 1 mW low and never high
+static void test_milliwatts_match_float() {
+    for (uint32_t adc = 0; adc <= 4095; adc++) {
+        double want = refMilliwatts(SWR_FWD_CAL, SWR_FWD_CAL_POINTS, adc);
+        double got  = fwdCurve.milliwatts(adc);
+        TEST_ASSERT_TRUE(got <= want && want - got < 1.02);
+    }
+    TEST_ASSERT_EQUAL(1000000, fwdCurve.milliwatts(4095));
+    TEST_ASSERT_EQUAL(1000000, fwdCurve.milliwatts(0xffff));
+}
+
+static void test_log2() {
+    TEST_ASSERT_EQUAL(0, log2Q8(0));
+    TEST_ASSERT_EQUAL(0, log2Q8(1));
+    for (uint32_t x = 1; x < 4000000; x = x * 5 / 4 + 1) {
+        double want = 256.0 * log2((double)x);
+        TEST_ASSERT_TRUE(fabs(log2Q8(x) - want) <= 1.5);
+    }
+}
+
+// SWR and return loss against the float formulas over the useful range
+// (SWR up to 10, forward power above 1 W). Return loss is truncated to the
+// 0.1 dB it is reported in, on top of the log2 table error.
+static void test_swr_accuracy() {
+    double worstSwr = 0, worstRl = 0;
+    for (uint16_t f = 200; f <= 4095; f += 15) {
+        for (uint16_t r = 0; r < f; r += 7) {
+            SwrResult out;
+            computeSWR(fwdCurve, refCurve, f, r, out);
+            if (out.fwdMw < 1000 || out.refMw == 0) continue;
+
+            double rho = sqrt((double)out.refMw / out.fwdMw);
+            double swr = (1 + rho) / (1 - rho);
+            if (swr > 10) continue;
+            double rl  = 10 * log10((double)out.fwdMw / out.refMw);
+
+            double eSwr = fabs(out.swrQ8 / 256.0 - swr) / swr;
+            double eRl  = fabs(out.returnLossDb10 / 10.0 - rl);
+            if (eSwr > worstSwr) worstSwr = eSwr;
+            if (eRl > worstRl) worstRl = eRl;
+        }
+    }
+    char msg[96];
+    snprintf(msg, sizeof(msg), "worst SWR error %.2f %%, worst return loss error %.3f dB", 100 * worstSwr, worstRl);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(worstSwr < 0.02);
+    TEST_ASSERT_TRUE(worstRl < 0.13);
+}
+
+static void test_swr_limits() {
+    SwrResult out;
+    computeSWR(fwdCurve, refCurve, 0, 100, out);
+    TEST_ASSERT_EQUAL(0, out.swrQ8);
+    TEST_ASSERT_EQUAL(0, out.returnLossDb10);
+
+    computeSWR(fwdCurve, refCurve, 2000, 0, out);
+    TEST_ASSERT_EQUAL(SWR_Q8_MIN, out.swrQ8);
+    TEST_ASSERT_EQUAL(SWR_RL_MAX_DB10, out.returnLossDb10);
+
+    computeSWR(fwdCurve, refCurve, 2000, 2000, out);
+    TEST_ASSERT_EQUAL(SWR_Q8_MAX, out.swrQ8);
+    TEST_ASSERT_EQUAL(0, out.returnLossDb10);
+
+    // 1 kW forward, 2 mW reflected: 57 dB
+    computeSWR(fwdCurve, refCurve, 4095, 1, out);
+    TEST_ASSERT_TRUE(out.swrQ8 >= SWR_Q8_MIN && out.swrQ8 < 260);
+    TEST_ASSERT_TRUE(out.returnLossDb10 > 560 && out.returnLossDb10 < 580);
+}
+
+static void test_load_rejects() {
+    const CalPoint falling[] = { { 0, 0 }, { 100, 50 }, { 200, 40 } };
+    const CalPoint sameAdc[] = { { 0, 0 }, { 100, 50 }, { 100, 60 } };
+    const CalPoint steep[]   = { { 0, 0 }, { 1, SWR_CAL_MAX_SLOPE_MW + 1 } };
+    const CalPoint limit[]   = { { 0, 0 }, { 1, SWR_CAL_MAX_SLOPE_MW } };
+    PowerCurve c;
+    TEST_ASSERT_FALSE(c.load(falling, 3));
+    TEST_ASSERT_FALSE(c.load(sameAdc, 3));
+    TEST_ASSERT_FALSE(c.load(steep, 2));
+    TEST_ASSERT_FALSE(c.load(SWR_FWD_CAL, 1));
+    TEST_ASSERT_FALSE(c.load(SWR_FWD_CAL, SWR_CAL_MAX_POINTS + 1));
+    TEST_ASSERT_EQUAL(0, c.milliwatts(50));
+
+    // the steepest accepted segment still interpolates without overflow
+    TEST_ASSERT_TRUE(c.load(limit, 2));
+    TEST_ASSERT_EQUAL(SWR_CAL_MAX_SLOPE_MW, c.milliwatts(1));
+
+    // a rejected curve leaves the loaded one in place
+    TEST_ASSERT_TRUE(c.load(SWR_FWD_CAL, SWR_FWD_CAL_POINTS));
+    TEST_ASSERT_FALSE(c.load(steep, 2));
+    TEST_ASSERT_EQUAL(1000000, c.milliwatts(4095));
+}
+
+// Per-sample cost of the fixed-point path against the same computation in
+// double with sqrt and log10
+static void test_benchmark_per_sample() {
+    const int N = 1000000;
+    volatile uint32_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        SwrResult out;
+        computeSWR(fwdCurve, refCurve, 400 + (i & 2047), i & 255, out);
+        sink += out.swrQ8 + out.returnLossDb10;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        double pf = refMilliwatts(SWR_FWD_CAL, SWR_FWD_CAL_POINTS, 400 + (i & 2047));
+        double pr = refMilliwatts(SWR_REF_CAL, SWR_REF_CAL_POINTS, i & 255);
+        double rho = pr > 0 ? sqrt(pr / pf) : 0;
+        double rl  = pr > 0 ? 10 * log10(pf / pr) : 60;
+        sink += (uint32_t)(256 * (1 + rho) / (1 - rho)) + (uint32_t)(10 * rl);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double fixedNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / N;
+    double floatNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / N;
+    char msg[96];
+    snprintf(msg, sizeof(msg), "per sample: fixed point %.1f ns, double %.1f ns", fixedNs, floatNs);
+    TEST_MESSAGE(msg);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_milliwatts_match_float);
+    RUN_TEST(test_log2);
+    RUN_TEST(test_swr_accuracy);
+    RUN_TEST(test_swr_limits);
+    RUN_TEST(test_load_rejects);
+    RUN_TEST(test_benchmark_per_sample);
+    return UNITY_END();
+}
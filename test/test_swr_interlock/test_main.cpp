@@ -0,0 +1,192 @@
+#include <unity.h>
+#include <math.h>
+#include "swr_interlock.h"
+#include "adc_pipeline.h"
+
+#define RATE_HZ     2000
+#define SAMPLE_US   (1000000 / RATE_HZ)
+
+// 1 W per ADC count on both channels keeps the power ratios exact
+static const CalPoint LINEAR[] = { { 0, 0 }, { 4000, 4000000 } };
+
+static PowerCurve   curve;
+static SwrInterlock *guard;
+static int          actions[2];     // calls with false / true
+
+static void onTrip(bool tripped, void *) {
+    actions[tripped]++;
+}
+
+void setUp() {
+    curve.load(LINEAR, 2);
+    guard = new SwrInterlock();
+    guard->begin(curve, curve, RATE_HZ, onTrip);
+    actions[0] = actions[1] = 0;
+}
+void tearDown() {
+    delete guard;
+}
+
+// one raw sample, then the sample period passes
+static void sample(uint16_t fwd, uint16_t ref) {
+    uint16_t adc[ADC_CHANNELS];
+    adc[ADC_CH_FWD] = fwd;
+    adc[ADC_CH_REF] = ref;
+    guard->process(adc, micros());
+    mockAdvance(SAMPLE_US);
+}
+
+// reflected counts for the given SWR at fwd counts
+static uint16_t reflectedFor(double swr, uint16_t fwd) {
+    double gamma = (swr - 1) / (swr + 1);
+    return (uint16_t)lround(fwd * gamma * gamma);
+}
+
+// SSB-like envelope at SWR 1.5 with SWR 2.5 peaks, and unkeyed gaps where
+// the reflected noise is larger than the forward power
+static void test_nominal_waveform_does_not_trip() {
+    for (uint32_t i = 0; i < 20 * RATE_HZ; i++) {
+        uint32_t phase = i % 400;
+        if (phase >= 300) {
+            sample(0, i & 3);
+            continue;
+        }
+        uint16_t fwd = (uint16_t)(1000 * fabs(sin(phase * M_PI / 300)));
+        double swr = (i % 997) == 0 ? 2.5 : 1.5;
+        sample(fwd, reflectedFor(swr, fwd));
+    }
+    TEST_ASSERT_FALSE(guard->tripped());
+    TEST_ASSERT_EQUAL(0, guard->trips());
+    TEST_ASSERT_EQUAL(0, actions[1]);
+}
+
+static void test_single_spike_does_not_trip_two_do() {
+    for (int i = 0; i < 10; i++) sample(1000, 40);
+    sample(1000, 900);
+    sample(1000, 40);
+    sample(1000, 900);
+    sample(1000, 40);
+    TEST_ASSERT_FALSE(guard->tripped());
+
+    uint32_t first = micros();
+    sample(1000, 900);
+    TEST_ASSERT_FALSE(guard->tripped());
+    sample(1000, 900);
+    TEST_ASSERT_TRUE(guard->tripped());
+    TEST_ASSERT_EQUAL(SWR_TRIP_SWR, guard->cause());
+    TEST_ASSERT_EQUAL(1, actions[1]);
+
+    // latency from the first sample over the limit: one sample period
+    TEST_ASSERT_EQUAL(micros() - SAMPLE_US - first, guard->lastLatency());
+    TEST_ASSERT_EQUAL((SWR_TRIP_SAMPLES - 1) * SAMPLE_US, guard->lastLatency());
+
+    // latched, the action runs once
+    for (int i = 0; i < 100; i++) sample(1000, 900);
+    TEST_ASSERT_EQUAL(1, guard->trips());
+    TEST_ASSERT_EQUAL(1, actions[1]);
+}
+
+// The limit is SWR 3.0, Pr/Pf = 1/4
+static void test_threshold() {
+    uint16_t below = reflectedFor(2.9, 1000);
+    uint16_t above = reflectedFor(3.05, 1000);
+    TEST_ASSERT_EQUAL(237, below);
+    TEST_ASSERT_EQUAL(256, above);
+
+    for (int i = 0; i < 1000; i++) sample(1000, below);
+    TEST_ASSERT_FALSE(guard->tripped());
+    for (int i = 0; i < 1000; i++) sample(1000, 249);
+    TEST_ASSERT_FALSE(guard->tripped());
+
+    sample(1000, above);
+    sample(1000, above);
+    TEST_ASSERT_TRUE(guard->tripped());
+}
+
+static void test_low_power_is_not_checked() {
+    // reflected noise without forward power
+    for (int i = 0; i < 100; i++) sample(0, 5);
+    TEST_ASSERT_FALSE(guard->tripped());
+    guard->setLimits(SWR_TRIP_Q8, 2000000, SWR_RF_MW);
+    for (int i = 0; i < 100; i++) sample(1000, 1000);     // 1 kW is below the raised minimum
+    TEST_ASSERT_FALSE(guard->tripped());
+    for (int i = 0; i < 2; i++) sample(2000, 2000);
+    TEST_ASSERT_TRUE(guard->tripped());
+}
+
+// RF counts as present for 250 ms after the forward power went away
+static void test_rf_hold() {
+    const uint32_t hold = SWR_RF_HOLD_MS * RATE_HZ / 1000;
+    TEST_ASSERT_FALSE(guard->rfPresent());
+    sample(1, 0);                                           // 1 W, above the RF level
+    TEST_ASSERT_TRUE(guard->rfPresent());
+
+    for (uint32_t i = 0; i < hold - 1; i++) sample(0, 0);
+    TEST_ASSERT_TRUE(guard->rfPresent());
+    sample(0, 0);
+    TEST_ASSERT_FALSE(guard->rfPresent());
+
+    // a new key-down within the hold time starts it over
+    sample(500, 20);
+    for (uint32_t i = 0; i < hold / 2; i++) sample(0, 0);
+    sample(500, 20);
+    for (uint32_t i = 0; i < hold - 1; i++) sample(0, 0);
+    TEST_ASSERT_TRUE(guard->rfPresent());
+    sample(0, 0);
+    TEST_ASSERT_FALSE(guard->rfPresent());
+}
+
+static void test_clear_refused_with_rf() {
+    sample(1000, 900);
+    sample(1000, 900);
+    TEST_ASSERT_TRUE(guard->tripped());
+
+    TEST_ASSERT_FALSE(guard->clear());
+    sample(0, 0);
+    TEST_ASSERT_FALSE(guard->clear());                       // still within the hold time
+    TEST_ASSERT_TRUE(guard->tripped());
+    TEST_ASSERT_EQUAL(0, actions[0]);
+
+    for (uint32_t i = 0; i < SWR_RF_HOLD_MS * RATE_HZ / 1000; i++) sample(0, 0);
+    TEST_ASSERT_TRUE(guard->clear());
+    TEST_ASSERT_FALSE(guard->tripped());
+    TEST_ASSERT_EQUAL(SWR_TRIP_NONE, guard->cause());
+    TEST_ASSERT_EQUAL(1, actions[0]);
+
+    // clear() on an untripped interlock does nothing
+    TEST_ASSERT_TRUE(guard->clear());
+    TEST_ASSERT_EQUAL(1, actions[0]);
+
+    // and it trips again
+    sample(1000, 900);
+    sample(1000, 900);
+    TEST_ASSERT_TRUE(guard->tripped());
+    TEST_ASSERT_EQUAL(2, guard->trips());
+}
+
+static void test_comparator_trip() {
+    uint32_t edge = micros();
+    mockAdvance(3);
+    guard->trip(SWR_TRIP_COMPARATOR, edge);
+    TEST_ASSERT_TRUE(guard->tripped());
+    TEST_ASSERT_EQUAL(SWR_TRIP_COMPARATOR, guard->cause());
+    TEST_ASSERT_EQUAL(3, guard->lastLatency());
+
+    // the sampler seeing the same fault does not trip it again
+    sample(1000, 900);
+    sample(1000, 900);
+    TEST_ASSERT_EQUAL(1, guard->trips());
+    TEST_ASSERT_EQUAL(SWR_TRIP_COMPARATOR, guard->cause());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_nominal_waveform_does_not_trip);
+    RUN_TEST(test_single_spike_does_not_trip_two_do);
+    RUN_TEST(test_threshold);
+    RUN_TEST(test_low_power_is_not_checked);
+    RUN_TEST(test_rf_hold);
+    RUN_TEST(test_clear_refused_with_rf);
+    RUN_TEST(test_comparator_trip);
+    return UNITY_END();
+}
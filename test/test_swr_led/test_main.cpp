@@ -0,0 +1,166 @@
+#include <unity.h>
+#include <math.h>
+#include <Arduino.h>
+#include <soc/gpio_reg.h>
+#include "swr_led.h"
+
+// The LEDs in bar order, they are active low
+static const uint8_t PINS[] = { SWRLED_01, SWRLED_04, SWRLED_05, SWRLED_06,
+                                SWRLED_07, SWRLED_08, SWRLED_09, SWRLED_10 };
+static const uint8_t LEDS = sizeof(PINS) / sizeof(PINS[0]);
+
+// GPIO register writes since the last call
+static uint32_t since;
+static uint32_t taken() {
+    uint32_t n = mockGpio().writes - since;
+    since = mockGpio().writes;
+    return n;
+}
+
+// bit n set = LED n lit
+static uint8_t lit() {
+    uint8_t on = 0;
+    for (uint8_t i = 0; i < LEDS; i++) {
+        if (!mockGpioLevel(PINS[i])) on |= 1 << i;
+    }
+    return on;
+}
+
+void setUp() {
+    // the module keeps its state, bring it back to an empty bar
+    setSWRDisplayMode(SWR_MODE_BAR, 1000, 100);
+    setSWRHysteresis(0);
+    updateSWRDisplay(0);
+    mockGpio() = MockGpio();
+    initSWRDisplay();
+    since = mockGpio().writes;
+}
+void tearDown() {}
+
+static void test_init_turns_all_off() {
+    TEST_ASSERT_EQUAL(2, mockGpio().writes);        // one set for each register
+    TEST_ASSERT_EQUAL(0, lit());
+}
+
+// Changed LEDs of a register go out in one write, unchanged ones not at all
+static void test_only_changes_are_written() {
+    uint32_t counted = swrLedWrites();
+    setSWRLeds(SWR_LEVELS);
+    TEST_ASSERT_EQUAL(0xff, lit());
+    TEST_ASSERT_EQUAL(2, taken());                  // clear in GPIO 0..31 and 32..
+
+    setSWRLeds(SWR_LEVELS);
+    TEST_ASSERT_EQUAL(0, taken());
+
+    setSWRLeds(5);                                  // LEDs 3..7 off
+    TEST_ASSERT_EQUAL(0x07, lit());
+    TEST_ASSERT_EQUAL(2, taken());
+
+    setSWRLeds(1);                                  // GPIO 15 and 7 off
+    TEST_ASSERT_EQUAL(0x01, lit());
+    TEST_ASSERT_EQUAL(1, taken());
+
+    setSWRLeds(4);                                  // GPIO 15 on
+    TEST_ASSERT_EQUAL(0x03, lit());
+    TEST_ASSERT_EQUAL(1, taken());
+
+    setSWRLeds(0);                                  // GPIO 48 and 15 off
+    TEST_ASSERT_EQUAL(0, lit());
+    TEST_ASSERT_EQUAL(2, taken());
+
+    TEST_ASSERT_EQUAL(8, swrLedWrites() - counted);
+}
+
+// A reading that wanders around a level boundary
+static void test_hysteresis() {
+    updateSWRDisplay(1630);                         // level 3, level 4 starts at 1638
+    TEST_ASSERT_EQUAL(0x01, lit());
+    taken();
+    for (int i = 0; i < 100; i++) updateSWRDisplay(i & 1 ? 1650 : 1630);
+    TEST_ASSERT_EQUAL(99, taken());                 // LED 2 on and off, from the second one
+
+    setSWRHysteresis(40);
+    updateSWRDisplay(1500);
+    TEST_ASSERT_EQUAL(0x01, lit());
+    taken();
+    for (int i = 0; i < 100; i++) updateSWRDisplay(i & 1 ? 1677 : 1598);
+    TEST_ASSERT_EQUAL(0, taken());
+    TEST_ASSERT_EQUAL(0x01, lit());
+
+    updateSWRDisplay(1678);
+    TEST_ASSERT_EQUAL(0x03, lit());
+    updateSWRDisplay(1598);                         // not yet below 1638 - 40
+    TEST_ASSERT_EQUAL(0x03, lit());
+    updateSWRDisplay(1597);
+    TEST_ASSERT_EQUAL(0x01, lit());
+}
+
+static void test_peak_hold() {
+    setSWRDisplayMode(SWR_MODE_PEAK_HOLD, 1000, 100);
+    updateSWRDisplay(SWR_RAW_MAX);
+    TEST_ASSERT_EQUAL(0xff, lit());
+
+    mockAdvance(999000);
+    updateSWRDisplay(0);
+    TEST_ASSERT_EQUAL(0xff, lit());
+    mockAdvance(1000);
+    updateSWRDisplay(0);
+    TEST_ASSERT_EQUAL(0, lit());
+}
+
+static void test_decay() {
+    setSWRDisplayMode(SWR_MODE_DECAY, 1000, 100);
+    updateSWRDisplay(SWR_RAW_MAX);
+    TEST_ASSERT_EQUAL(0xff, lit());
+
+    // one level per 100 ms, updates every 10 ms
+    for (int ms = 10; ms <= 350; ms += 10) {
+        mockAdvance(10000);
+        updateSWRDisplay(0);
+    }
+    TEST_ASSERT_EQUAL(0x1f, lit());                 // level 7
+    for (int ms = 360; ms <= 1000; ms += 10) {
+        mockAdvance(10000);
+        updateSWRDisplay(0);
+    }
+    TEST_ASSERT_EQUAL(0, lit());
+}
+
+// Register writes per second for a display updated at 1 kHz with a noisy
+// reading, against writing every LED pin on every update
+static void test_writes_per_second() {
+    const uint32_t seconds = 10;
+    uint32_t perSecond[2];
+    const uint16_t hyst[2] = { 0, 40 };
+    for (uint8_t h = 0; h < 2; h++) {
+        setSWRHysteresis(hyst[h]);
+        uint32_t seed = 1;
+        taken();
+        for (uint32_t ms = 0; ms < seconds * 1000; ms++) {
+            seed = seed * 1103515245 + 12345;
+            int32_t noise = (int32_t)((seed >> 16) % 61) - 30;
+            double swing = 0.5 - 0.5 * cos(ms * 2 * M_PI / 4000);
+            int32_t raw = (int32_t)(swing * 3000) + 500 + noise;
+            updateSWRDisplay((uint16_t)raw);
+            mockAdvance(1000);
+        }
+        perSecond[h] = taken() / seconds;
+    }
+    char msg[128];
+    snprintf(msg, sizeof(msg), "GPIO writes/s at 1 kHz: every pin %u, changes only %u, with hysteresis %u",
+             (unsigned)(LEDS * 1000), (unsigned)perSecond[0], (unsigned)perSecond[1]);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(perSecond[1] < perSecond[0]);
+    TEST_ASSERT_TRUE(perSecond[1] <= 10);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_init_turns_all_off);
+    RUN_TEST(test_only_changes_are_written);
+    RUN_TEST(test_hysteresis);
+    RUN_TEST(test_peak_hold);
+    RUN_TEST(test_decay);
+    RUN_TEST(test_writes_per_second);
+    return UNITY_END();
+}
@@ -0,0 +1,172 @@
+#include <unity.h>
+#include <stdio.h>
+#include "tca9539.h"
+
+#define ADDR    0x74
+
+typedef TCA9539::Port Port;
+
+static TwoWire *bus;
+static TCA9539 *io;
+
+void setUp() {
+    bus = new TwoWire();
+    bus->attach(ADDR);
+    io = new TCA9539();
+    io->attach(*bus);
+    io->setDeviceAddress(ADDR);
+}
+void tearDown() {
+    delete io;
+    delete bus;
+}
+
+// bus transactions taken by the last operation
+static uint32_t since;
+static uint32_t taken() {
+    uint32_t n = bus->transactions - since;
+    since = bus->transactions;
+    return n;
+}
+
+static void test_sync_loads_the_shadow() {
+    since = 0;
+    TEST_ASSERT_TRUE(io->sync());
+    TEST_ASSERT_EQUAL(3, taken());                  // OUTPUT, POLARITY and CONFIG pairs
+
+    TEST_ASSERT_EQUAL(0xffff, io->output16());
+    TEST_ASSERT_EQUAL(0xff, io->output(Port::PORT2));
+    TEST_ASSERT_EQUAL(0xffff, io->config16());
+    TEST_ASSERT_EQUAL(0, io->polarity16());
+    TEST_ASSERT_EQUAL(0, taken());
+
+    // inputs are never cached
+    bus->dev[ADDR].regs[0] = 0x5a;
+    TEST_ASSERT_EQUAL(0x5a, io->input(Port::PORT1));
+    TEST_ASSERT_EQUAL(0x02, io->input(Port::PORT1, 1));    // the bit, not shifted down
+    TEST_ASSERT_EQUAL(2, taken());
+}
+
+static void test_single_pin_write_is_one_transaction() {
+    io->sync();
+    since = bus->transactions;
+
+    TEST_ASSERT_TRUE(io->output(Port::PORT1, 3, 0));
+    TEST_ASSERT_EQUAL(1, taken());
+    TEST_ASSERT_EQUAL(0xf7, bus->dev[ADDR].regs[2]);
+
+    TEST_ASSERT_TRUE(io->output(Port::PORT2, 0, 0));
+    TEST_ASSERT_TRUE(io->config(Port::PORT1, 3, TCA9539::Config::OUT));
+    TEST_ASSERT_EQUAL(2, taken());
+    TEST_ASSERT_EQUAL(0xfe, bus->dev[ADDR].regs[3]);
+    TEST_ASSERT_EQUAL(0xf7, bus->dev[ADDR].regs[6]);
+    TEST_ASSERT_EQUAL(0xfef7, io->output16());
+    TEST_ASSERT_EQUAL(0, taken());
+}
+
+// the point of the shadow: writing what the device already holds is free
+static void test_unchanged_writes_are_free() {
+    io->sync();
+    io->output16(0x1234);
+    since = bus->transactions;
+
+    for (int i = 0; i < 100; i++) {
+        TEST_ASSERT_TRUE(io->output16(0x1234));
+        TEST_ASSERT_TRUE(io->output(Port::PORT1, 4, 1));
+        TEST_ASSERT_TRUE(io->output(Port::PORT2, 0x12));
+        TEST_ASSERT_TRUE(io->config16(0xffff));
+        TEST_ASSERT_TRUE(io->polarity(Port::PORT1, TCA9539::Polarity::ORIGINAL));
+    }
+    TEST_ASSERT_EQUAL(0, taken());
+    TEST_ASSERT_EQUAL(0, io->status());
+
+    // a word where one half changes is still written as a whole
+    TEST_ASSERT_TRUE(io->output16(0x1235));
+    TEST_ASSERT_EQUAL(1, taken());
+    TEST_ASSERT_EQUAL(0x35, bus->dev[ADDR].regs[2]);
+    TEST_ASSERT_EQUAL(0x12, bus->dev[ADDR].regs[3]);
+}
+
+// without a sync the first access to a register reads it once
+static void test_cold_cache() {
+    since = bus->transactions;
+    TEST_ASSERT_TRUE(io->output(Port::PORT1, 0, 0));
+    TEST_ASSERT_EQUAL(2, taken());                  // read, then write
+    TEST_ASSERT_TRUE(io->output(Port::PORT1, 1, 0));
+    TEST_ASSERT_EQUAL(1, taken());
+
+    io->invalidate();
+    TEST_ASSERT_TRUE(io->output(Port::PORT1, 1, 0));
+    TEST_ASSERT_EQUAL(1, taken());                  // re-read, the bit is already clear
+    TEST_ASSERT_TRUE(io->output(Port::PORT1, 2, 0));
+    TEST_ASSERT_EQUAL(1, taken());
+    TEST_ASSERT_EQUAL(0xf8, bus->dev[ADDR].regs[2]);
+}
+
+// An expander reset behind the driver's back: invalidate() and the same
+// write goes out again
+static void test_invalidate_after_reset() {
+    io->sync();
+    io->output16(0);
+    bus->attach(ADDR);                              // power-on values again
+    since = bus->transactions;
+
+    TEST_ASSERT_TRUE(io->output16(0));
+    TEST_ASSERT_EQUAL(0, taken());
+    TEST_ASSERT_EQUAL(0xff, bus->dev[ADDR].regs[2]);
+
+    io->invalidate();
+    TEST_ASSERT_TRUE(io->output16(0));
+    TEST_ASSERT_EQUAL(1, taken());
+    TEST_ASSERT_EQUAL(0, bus->dev[ADDR].regs[2]);
+}
+
+// a failed write drops the shadow of its registers, so the retry is not
+// skipped
+static void test_failed_write_is_not_cached() {
+    io->sync();
+    since = bus->transactions;
+    bus->failNext = 4;                              // the write and all its retries
+    TEST_ASSERT_FALSE(io->output16(0x0f0f));
+    TEST_ASSERT_EQUAL(4, taken());
+    TEST_ASSERT_EQUAL(5, io->status());
+
+    TEST_ASSERT_TRUE(io->output16(0xffff));         // what the device still holds
+    TEST_ASSERT_EQUAL(1, taken());
+    TEST_ASSERT_TRUE(io->output16(0xffff));
+    TEST_ASSERT_EQUAL(0, taken());
+}
+
+// transactions per operation, before and after the shadow
+static void test_transactions_per_operation() {
+    io->sync();
+    since = bus->transactions;
+    uint32_t relay = 0, unchanged = 0, readBack = 0;
+    for (int i = 0; i < 1000; i++) {
+        io->output(Port::PORT1, i & 7, (i >> 3) & 1);
+        relay += taken();
+        io->output16(io->output16());
+        unchanged += taken();
+        io->config16();
+        readBack += taken();
+    }
+    char msg[128];
+    snprintf(msg, sizeof(msg), "per 1000: pin write %u, rewrite of the same word %u, register read %u transactions",
+             (unsigned)relay, (unsigned)unchanged, (unsigned)readBack);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL(1000, relay);
+    TEST_ASSERT_EQUAL(0, unchanged);
+    TEST_ASSERT_EQUAL(0, readBack);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sync_loads_the_shadow);
+    RUN_TEST(test_single_pin_write_is_one_transaction);
+    RUN_TEST(test_unchanged_writes_are_free);
+    RUN_TEST(test_cold_cache);
+    RUN_TEST(test_invalidate_after_reset);
+    RUN_TEST(test_failed_write_is_not_cached);
+    RUN_TEST(test_transactions_per_operation);
+    return UNITY_END();
+}
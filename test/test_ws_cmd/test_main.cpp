@@ -0,0 +1,223 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "ws_cmd.h"
+
+// the firmware table
+static const WsCommand *const TABLE = WS_COMMANDS;
+static const size_t COUNT = WS_COMMAND_COUNT;
+
+void setUp() {}
+void tearDown() {}
+
+static bool find(const char *frame, const char **value, size_t *len) {
+    return wsFindAction((const uint8_t *)frame, strlen(frame), value, len);
+}
+
+static void test_find_action() {
+    const char *v;
+    size_t len;
+    TEST_ASSERT_TRUE(find("{\"action\":\"NE\"}", &v, &len));
+    TEST_ASSERT_EQUAL(2, len);
+    TEST_ASSERT_EQUAL_MEMORY("NE", v, 2);
+
+    TEST_ASSERT_TRUE(find(" { \"x\" : [1, {\"action\":\"no\"}], \"action\" : \"scan\" } ", &v, &len));
+    TEST_ASSERT_EQUAL(4, len);
+    TEST_ASSERT_EQUAL_MEMORY("scan", v, 4);
+
+    // a value that looks like the key does not count
+    TEST_ASSERT_TRUE(find("{\"a\":\"action\",\"action\":\"W\"}", &v, &len));
+    TEST_ASSERT_EQUAL_MEMORY("W", v, 1);
+}
+
+static void test_find_action_rejects() {
+    const char *v;
+    size_t len;
+    TEST_ASSERT_FALSE(find("", &v, &len));
+    TEST_ASSERT_FALSE(find("{}", &v, &len));
+    TEST_ASSERT_FALSE(find("{\"action\":3}", &v, &len));
+    TEST_ASSERT_FALSE(find("{\"action\":null}", &v, &len));
+    TEST_ASSERT_FALSE(find("{\"action\":\"NE", &v, &len));
+    TEST_ASSERT_FALSE(find("{\"action\":\"N\\u0045\"}", &v, &len));
+    TEST_ASSERT_FALSE(find("{\"inner\":{\"action\":\"NE\"}}", &v, &len));
+
+    const uint8_t nul[] = "{\"action\":\"S\0xxxxxxxxxxxxx\"}";
+    TEST_ASSERT_FALSE(wsFindAction(nul, sizeof(nul) - 1, &v, &len));
+}
+
+static void test_lookup_every_name() {
+    TEST_ASSERT_TRUE(wsIsSorted(TABLE, COUNT));
+    for (size_t i = 0; i < COUNT; i++) {
+        const WsCommand *c = wsLookup(TABLE, COUNT, TABLE[i].name, strlen(TABLE[i].name));
+        TEST_ASSERT_EQUAL_PTR(&TABLE[i], c);
+    }
+}
+
+static void test_lookup_misses() {
+    TEST_ASSERT_NULL(wsLookup(TABLE, COUNT, "N", 1));          // prefix of NE, NN, NW
+    TEST_ASSERT_NULL(wsLookup(TABLE, COUNT, "SWW", 3));        // longer than SW
+    TEST_ASSERT_NULL(wsLookup(TABLE, COUNT, "", 0));
+    TEST_ASSERT_NULL(wsLookup(TABLE, COUNT, "toggles", 7));
+    TEST_ASSERT_NULL(wsLookup(TABLE, COUNT, "A", 1));
+    TEST_ASSERT_NULL(wsLookup(TABLE, COUNT, "zz", 2));
+    TEST_ASSERT_NULL(wsLookup(TABLE, 0, "E", 1));
+
+    // only nameLen bytes count, even with a NUL inside
+    TEST_ASSERT_NULL(wsLookup(TABLE, COUNT, "S\0xxxxxxxxxx", 12));
+    TEST_ASSERT_EQUAL_STRING("S", wsLookup(TABLE, COUNT, "SE", 1)->name);
+}
+
+static void test_dispatch() {
+    const char *v;
+    size_t len;
+    TEST_ASSERT_TRUE(find("{\"action\":\"toggle\"}", &v, &len));
+    const WsCommand *c = wsLookup(TABLE, COUNT, v, len);
+    TEST_ASSERT_NOT_NULL(c);
+    TEST_ASSERT_EQUAL(WsAction::TOGGLE, c->action);
+
+    // the directions the UI buttons send
+    static const char *const DIRS[] = { "NN", "NE", "E", "SE", "S", "SW", "W", "NW" };
+    for (uint8_t d = 0; d < 8; d++) {
+        c = wsLookup(TABLE, COUNT, DIRS[d], strlen(DIRS[d]));
+        TEST_ASSERT_NOT_NULL(c);
+        TEST_ASSERT_EQUAL(WsAction::DIRECTION, c->action);
+        TEST_ASSERT_EQUAL(d + 1, c->arg);
+    }
+    TEST_ASSERT_EQUAL(WsAction::SCAN, wsLookup(TABLE, COUNT, "scan", 4)->action);
+    TEST_ASSERT_EQUAL(WsAction::CLEAR, wsLookup(TABLE, COUNT, "clear", 5)->action);
+}
+
+// The old path: deserializeJson() built a document of the whole frame with
+// the strings copied to the heap, then json["action"] was compared with
+// strcmp() against every name. ArduinoJson is not in the native build, this
+// parser of flat objects stands in for it.
+struct Member {
+    const char *key;
+    const char *value;
+};
+struct Doc {
+    char   *pool;
+    Member  members[8];
+    uint8_t count;
+};
+
+static const char *jsonString(const char *&p, const char *end, char *&out) {
+    const char *s = out;
+    for (p++; p < end && *p != '"'; p++) {
+        if (*p == '\\' && p + 1 < end) p++;
+        *out++ = *p;
+    }
+    *out++ = '\0';
+    p++;
+    return s;
+}
+
+static bool parseDoc(const char *data, size_t len, Doc &doc) {
+    const char *p = data, *end = data + len;
+    doc.pool  = (char *)malloc(len + 1);
+    doc.count = 0;
+    char *out = doc.pool;
+    while (p < end && *p != '{') p++;
+    for (p++; p < end && doc.count < 8; ) {
+        while (p < end && (*p == ' ' || *p == ',')) p++;
+        if (p >= end || *p == '}') return true;
+        if (*p != '"') return false;
+        Member &m = doc.members[doc.count++];
+        m.key = jsonString(p, end, out);
+        while (p < end && (*p == ' ' || *p == ':')) p++;
+        if (p < end && *p == '"') {
+            m.value = jsonString(p, end, out);
+        } else {
+            m.value = out;
+            while (p < end && *p != ',' && *p != '}') *out++ = *p++;
+            *out++ = '\0';
+        }
+    }
+    return false;
+}
+
+static const char *member(const Doc &doc, const char *key) {
+    for (uint8_t i = 0; i < doc.count; i++) {
+        if (strcmp(doc.members[i].key, key) == 0) return doc.members[i].value;
+    }
+    return NULL;
+}
+
+static void test_old_path_parse() {
+    const char frame[] = "{\"id\":7, \"action\":\"N\\\"E\",\"x\":true}";
+    Doc doc;
+    TEST_ASSERT_TRUE(parseDoc(frame, sizeof(frame) - 1, doc));
+    TEST_ASSERT_EQUAL(3, doc.count);
+    TEST_ASSERT_EQUAL_STRING("N\"E", member(doc, "action"));
+    TEST_ASSERT_EQUAL_STRING("7", member(doc, "id"));
+    TEST_ASSERT_NULL(member(doc, "y"));
+    free(doc.pool);
+}
+
+// Frames per second through the scanner and the table, against parsing the
+// frame and running the strcmp chain in the order the old handler had it
+static void test_benchmark_dispatch() {
+    static const char *const FRAMES[] = {
+        "{\"action\":\"NE\"}", "{\"action\":\"toggle\"}", "{\"action\":\"W\"}", "{\"action\":\"scan\"}",
+    };
+    static const char *const CHAIN[] = {
+        "toggle", "NN", "NE", "E", "SE", "S", "SW", "W", "NW", "scan", "clear",
+    };
+    const int N = 1000000;
+    size_t lens[4];
+    for (int i = 0; i < 4; i++) lens[i] = strlen(FRAMES[i]);
+    volatile uint32_t sink = 0;
+    uint32_t found[2] = { 0, 0 };
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        const char *v;
+        size_t len;
+        if (wsFindAction((const uint8_t *)FRAMES[i & 3], lens[i & 3], &v, &len)) {
+            const WsCommand *c = wsLookup(TABLE, COUNT, v, len);
+            if (c) {
+                sink = sink + c->arg;
+                found[0]++;
+            }
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        Doc doc;
+        if (parseDoc(FRAMES[i & 3], lens[i & 3], doc)) {
+            const char *action = member(doc, "action");
+            // the old handler tested every name, there was no else
+            for (size_t k = 0; action && k < sizeof(CHAIN) / sizeof(CHAIN[0]); k++) {
+                if (strcmp(action, CHAIN[k]) == 0) {
+                    sink = sink + k;
+                    found[1]++;
+                }
+            }
+        }
+        free(doc.pool);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double table = N / std::chrono::duration<double>(t1 - t0).count();
+    double chain = N / std::chrono::duration<double>(t2 - t1).count();
+    char msg[160];
+    snprintf(msg, sizeof(msg), "dispatch: scanner + table %.2f M frames/s, "
+             "heap parse + strcmp chain %.2f M/s (host, stand-in parser)", table / 1e6, chain / 1e6);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL(N, found[0]);
+    TEST_ASSERT_EQUAL(N, found[1]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_find_action);
+    RUN_TEST(test_find_action_rejects);
+    RUN_TEST(test_lookup_every_name);
+    RUN_TEST(test_lookup_misses);
+    RUN_TEST(test_dispatch);
+    RUN_TEST(test_old_path_parse);
+    RUN_TEST(test_benchmark_dispatch);
+    return UNITY_END();
+}
@@ -0,0 +1,171 @@
+#include <unity.h>
+#include "ws_outbox.h"
+
+static WsOutbox box;
+
+void setUp() {
+    box.clear();
+    box = WsOutbox();
+}
+void tearDown() {
+    box.clear();
+}
+
+// a frame holding one tag byte
+static WsFrame *frame(uint8_t tag) {
+    WsFrame *f = wsFrameAlloc(1, false);
+    f->data[0] = tag;
+    return f;
+}
+
+static void push(WsFrameClass cls, uint8_t tag, bool ok = true) {
+    WsFrame *f = frame(tag);
+    TEST_ASSERT_EQUAL(ok, box.push(cls, f));
+    wsFrameRelease(f);
+}
+
+// sends the oldest frame, returns its tag or 0 when empty
+static uint8_t send() {
+    WsFrame *f = box.peek();
+    if (f == NULL) return 0;
+    uint8_t tag = f->data[0];
+    box.pop(f);
+    wsFrameRelease(f);
+    return tag;
+}
+
+static void test_state_is_replaced_in_place() {
+    push(WsFrameClass::ACK, 1);
+    push(WsFrameClass::STATE, 2);
+    push(WsFrameClass::TELEMETRY, 3);
+    push(WsFrameClass::STATE, 4);
+    push(WsFrameClass::STATE, 5);
+    TEST_ASSERT_EQUAL(3, box.depth());
+    TEST_ASSERT_EQUAL(2, box.replaced());
+
+    // the newest state keeps the place of the first one
+    TEST_ASSERT_EQUAL(1, send());
+    TEST_ASSERT_EQUAL(5, send());
+    TEST_ASSERT_EQUAL(3, send());
+    TEST_ASSERT_EQUAL(0, send());
+    TEST_ASSERT_EQUAL(3, box.sent());
+}
+
+static void test_state_replaced_after_peek_stays_queued() {
+    push(WsFrameClass::STATE, 1);
+    WsFrame *f = box.peek();
+    push(WsFrameClass::STATE, 2);
+    box.pop(f);                                     // 1 went out, 2 did not
+    wsFrameRelease(f);
+    TEST_ASSERT_EQUAL(1, box.depth());
+    TEST_ASSERT_EQUAL(2, send());
+}
+
+static void test_telemetry_drops_oldest() {
+    push(WsFrameClass::TELEMETRY, 1);
+    push(WsFrameClass::TELEMETRY, 2);
+    for (uint8_t i = 0; i < WS_OUTBOX_LEN - 3; i++) push(WsFrameClass::ACK, 10 + i);
+    push(WsFrameClass::STATE, 20);
+    TEST_ASSERT_EQUAL(WS_OUTBOX_LEN, box.depth());
+
+    // a new ack pushes out the oldest telemetry, a state frame still fits
+    // in its reserved slot
+    push(WsFrameClass::ACK, 30);
+    TEST_ASSERT_EQUAL(1, box.dropped());
+    push(WsFrameClass::STATE, 21);
+    TEST_ASSERT_EQUAL(WS_OUTBOX_LEN, box.depth());
+
+    // newer telemetry replaces older telemetry
+    push(WsFrameClass::TELEMETRY, 3);
+    TEST_ASSERT_EQUAL(2, box.dropped());
+    push(WsFrameClass::TELEMETRY, 4);
+    TEST_ASSERT_EQUAL(3, box.dropped());
+
+    TEST_ASSERT_EQUAL(10, send());
+    for (uint8_t i = 1; i < WS_OUTBOX_LEN - 3; i++) send();
+    TEST_ASSERT_EQUAL(21, send());
+    TEST_ASSERT_EQUAL(30, send());
+    TEST_ASSERT_EQUAL(4, send());
+    TEST_ASSERT_EQUAL(0, send());
+}
+
+static void test_full_of_acks_refuses_ack() {
+    for (uint8_t i = 0; i < WS_OUTBOX_LEN - 1; i++) push(WsFrameClass::ACK, 1 + i);
+    push(WsFrameClass::ACK, 99, false);
+    push(WsFrameClass::TELEMETRY, 98);
+    TEST_ASSERT_EQUAL(1, box.dropped());
+    TEST_ASSERT_EQUAL(WS_OUTBOX_LEN - 1, box.depth());
+
+    // the slot kept for state is still there
+    push(WsFrameClass::STATE, 50);
+    TEST_ASSERT_EQUAL(WS_OUTBOX_LEN, box.depth());
+    TEST_ASSERT_EQUAL(WS_OUTBOX_LEN, box.maxDepth());
+}
+
+// one frame shared by several outboxes is freed with the last reference
+static void test_frame_references() {
+    WsOutbox other;
+    WsFrame *f = frame(7);
+    TEST_ASSERT_TRUE(box.push(WsFrameClass::TELEMETRY, f));
+    TEST_ASSERT_TRUE(other.push(WsFrameClass::TELEMETRY, f));
+    TEST_ASSERT_EQUAL(3, f->refs.load());
+
+    other.clear();
+    TEST_ASSERT_EQUAL(2, f->refs.load());
+
+    WsFrame *p = box.peek();
+    TEST_ASSERT_TRUE(p == f);
+    TEST_ASSERT_EQUAL(3, f->refs.load());
+    box.pop(p);
+    wsFrameRelease(p);
+    TEST_ASSERT_EQUAL(1, f->refs.load());
+
+    // replaced and dropped frames give their reference back at once
+    WsFrame *s = frame(8);
+    box.push(WsFrameClass::STATE, s);
+    push(WsFrameClass::STATE, 9);
+    TEST_ASSERT_EQUAL(1, s->refs.load());
+
+    for (uint8_t i = 0; i < WS_OUTBOX_LEN; i++) box.push(WsFrameClass::TELEMETRY, f);
+    TEST_ASSERT_EQUAL(1 + WS_OUTBOX_LEN - 1, f->refs.load());
+    box.clear();
+    TEST_ASSERT_EQUAL(1, f->refs.load());
+    TEST_ASSERT_EQUAL(1, s->refs.load());
+
+    wsFrameRelease(f);
+    wsFrameRelease(s);
+}
+
+// A client that takes one frame every 10 ticks while a state frame comes
+// every tick, telemetry every 5 ticks and an ack every 20: the backlog
+// stays at WS_OUTBOX_LEN and no ack is lost.
+static void test_slow_consumer() {
+    uint32_t acksSent = 0, acksQueued = 0;
+    for (uint32_t tick = 1; tick <= 10000; tick++) {
+        push(WsFrameClass::STATE, 1);
+        if (tick % 5 == 0) push(WsFrameClass::TELEMETRY, 2);
+        if (tick % 20 == 0) {
+            push(WsFrameClass::ACK, 3);
+            acksQueued++;
+        }
+        if (tick % 10 == 0 && send() == 3) acksSent++;
+    }
+    while (uint8_t tag = send()) {
+        if (tag == 3) acksSent++;
+    }
+    TEST_ASSERT_EQUAL(acksQueued, acksSent);
+    TEST_ASSERT_TRUE(box.maxDepth() <= WS_OUTBOX_LEN);
+    TEST_ASSERT_TRUE(box.dropped() > 0);
+    TEST_ASSERT_TRUE(box.replaced() > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_state_is_replaced_in_place);
+    RUN_TEST(test_state_replaced_after_peek_stays_queued);
+    RUN_TEST(test_telemetry_drops_oldest);
+    RUN_TEST(test_full_of_acks_refuses_ack);
+    RUN_TEST(test_frame_references);
+    RUN_TEST(test_slow_consumer);
+    return UNITY_END();
+}
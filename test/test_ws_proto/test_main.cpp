@@ -0,0 +1,121 @@
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include "ws_proto.h"
+
+static const StateFrame SAMPLE = { 1, 3, 5, 0x05, 0x1234, 0xdeadbeef, 0x01020304 };
+
+void setUp() {}
+void tearDown() {}
+
+static void test_state_round_trip() {
+    uint8_t buf[WS_STATE_FRAME_LEN];
+    TEST_ASSERT_EQUAL(WS_STATE_FRAME_LEN, encodeStateFrame(SAMPLE, buf, sizeof(buf)));
+
+    StateFrame out = {};
+    TEST_ASSERT_TRUE(decodeStateFrame(buf, sizeof(buf), out));
+    TEST_ASSERT_EQUAL(SAMPLE.status, out.status);
+    TEST_ASSERT_EQUAL(SAMPLE.actualDir, out.actualDir);
+    TEST_ASSERT_EQUAL(SAMPLE.wantedDir, out.wantedDir);
+    TEST_ASSERT_EQUAL(SAMPLE.flags, out.flags);
+    TEST_ASSERT_EQUAL(SAMPLE.swr, out.swr);
+    TEST_ASSERT_EQUAL(SAMPLE.seq, out.seq);
+    TEST_ASSERT_EQUAL(SAMPLE.timestamp, out.timestamp);
+}
+
+// the layout documented in ws_proto.h, little-endian
+static void test_state_layout() {
+    uint8_t buf[WS_STATE_FRAME_LEN];
+    encodeStateFrame(SAMPLE, buf, sizeof(buf));
+    const uint8_t expected[WS_STATE_FRAME_LEN] = {
+        WS_PROTO_VERSION, WS_FRAME_STATE, 1, 3, 5, 0x05, 0x34, 0x12,
+        0xef, 0xbe, 0xad, 0xde, 0x04, 0x03, 0x02, 0x01
+    };
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, sizeof(buf));
+}
+
+static void test_state_rejects_bad_frames() {
+    uint8_t buf[WS_STATE_FRAME_LEN];
+    StateFrame out;
+    TEST_ASSERT_EQUAL(0, encodeStateFrame(SAMPLE, buf, sizeof(buf) - 1));
+
+    encodeStateFrame(SAMPLE, buf, sizeof(buf));
+    TEST_ASSERT_FALSE(decodeStateFrame(buf, sizeof(buf) - 1, out));
+    buf[0] = WS_PROTO_VERSION + 1;
+    TEST_ASSERT_FALSE(decodeStateFrame(buf, sizeof(buf), out));
+    buf[0] = WS_PROTO_VERSION;
+    buf[1] = WS_FRAME_CAPTURE;
+    TEST_ASSERT_FALSE(decodeStateFrame(buf, sizeof(buf), out));
+}
+
+static void test_scan_frame() {
+    const ScanEntry entries[2] = { { 4, 10, 300, 290, 310 }, { 7, 0, 0, 0, 0 } };
+    uint8_t buf[WS_SCAN_HEADER_LEN + 2 * WS_SCAN_ENTRY_LEN];
+    TEST_ASSERT_EQUAL(0, encodeScanFrame(entries, 2, 1, 2345, buf, sizeof(buf) - 1));
+    TEST_ASSERT_EQUAL(sizeof(buf), encodeScanFrame(entries, 2, 1, 2345, buf, sizeof(buf)));
+    const uint8_t expected[] = {
+        WS_PROTO_VERSION, WS_FRAME_SCAN, 1, 2, 0x29, 0x09, 0, 0,
+        4, 10, 0x2c, 0x01, 0x22, 0x01, 0x36, 0x01,
+        7, 0, 0, 0, 0, 0, 0, 0
+    };
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, sizeof(buf));
+}
+
+static void test_ack_frame_cuts_long_names() {
+    char name[WS_ACK_ACTION_MAX + 8];
+    memset(name, 'x', sizeof(name));
+    uint8_t buf[WS_ACK_HEADER_LEN + WS_ACK_ACTION_MAX];
+    TEST_ASSERT_EQUAL(sizeof(buf), encodeAckFrame(true, name, sizeof(name), buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL(WS_FRAME_ACK, buf[1]);
+    TEST_ASSERT_EQUAL(1, buf[2]);
+    TEST_ASSERT_EQUAL(WS_ACK_ACTION_MAX, buf[3]);
+
+    TEST_ASSERT_EQUAL(WS_ACK_HEADER_LEN + 2, encodeAckFrame(false, "NE", 2, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL(0, buf[2]);
+    TEST_ASSERT_EQUAL_MEMORY("NE", &buf[4], 2);
+}
+
+// Bytes and CPU time per notification against the JSON text the /ws
+// clients get. The JSON side is built with snprintf, which is cheaper than
+// the ArduinoJson document the firmware builds, so the gap is a lower bound.
+static void test_benchmark_state_frame() {
+    const int N = 1000000;
+    uint8_t bin[WS_STATE_FRAME_LEN];
+    char text[128];
+    volatile uint32_t sink = 0;
+    StateFrame f = SAMPLE;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        f.seq = i;
+        sink += encodeStateFrame(f, bin, sizeof(bin)) + bin[8];
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    size_t textLen = 0;
+    for (int i = 0; i < N; i++) {
+        textLen = snprintf(text, sizeof(text),
+                           "{\"status\":\"%s\",\"dir\":%u,\"rf\":%s,\"trip\":%s,\"scan\":%s,\"fault\":%s}",
+                           i & 1 ? "on" : "off", (unsigned)(i & 7), "false", "false", "true", "false");
+        sink += text[10];
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double binNs  = std::chrono::duration<double, std::nano>(t1 - t0).count() / N;
+    double textNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / N;
+    char msg[160];
+    snprintf(msg, sizeof(msg), "state frame: binary %u bytes %.1f ns, JSON %u bytes %.1f ns",
+             (unsigned)WS_STATE_FRAME_LEN, binNs, (unsigned)textLen, textNs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_THAN(textLen, WS_STATE_FRAME_LEN);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_state_round_trip);
+    RUN_TEST(test_state_layout);
+    RUN_TEST(test_state_rejects_bad_frames);
+    RUN_TEST(test_scan_frame);
+    RUN_TEST(test_ack_frame_cuts_long_names);
+    RUN_TEST(test_benchmark_state_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,128 @@
+# ----------------------------------------------------------------------------
+# Web asset build step (PlatformIO extra script)
+# ----------------------------------------------------------------------------
+#
+# Builds the filesystem image from a processed copy of data/:
+#
+#   - .html/.css/.js are minified (whitespace and comments only, the code is
+#     never rewritten), these and .ico are stored gzipped as <name>.gz
+#   - every asset gets a content-hash ETag, index.html refers to the other
+#     assets as <name>?v=<hash> so they can be cached for good
+#   - /assets.txt lists "<path> <etag> <content type>" for the server, see
+#     initAssets() in src/main.cpp
+#
+# Other files, e.g. cal.json, are copied as they are.
+
+Import("env")
+
+import gzip
+import hashlib
+import os
+import re
+import shutil
+
+SRC_DIR = os.path.join(env.subst("$PROJECT_DIR"), "data")
+OUT_DIR = os.path.join(env.subst("$BUILD_DIR"), "data")
+
+TYPES = {
+    ".html": "text/html",
+    ".css":  "text/css",
+    ".js":   "application/javascript",
+    ".ico":  "image/x-icon",
+}
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    return re.sub(r"\s*([{};,>])\s*", r"\1", text).strip()
+
+
+def minify_lines(text, block_start, block_end, line_comment=None):
+    # line based so that statements stay on their own line, no ASI surprises
+    out = []
+    in_block = False
+    for line in text.splitlines():
+        line = line.strip()
+        if in_block:
+            in_block = block_end not in line
+            continue
+        if line.startswith(block_start):
+            in_block = block_end not in line
+            continue
+        if not line or (line_comment and line.startswith(line_comment)):
+            continue
+        out.append(line)
+    return "\n".join(out) + "\n"
+
+
+def minify(name, text):
+    ext = os.path.splitext(name)[1]
+    if ext == ".css":
+        return minify_css(text)
+    if ext == ".html":
+        return minify_lines(text, "<!--", "-->")
+    if ext == ".js":
+        # a template literal across lines would be changed by the stripping
+        if any(line.count("`") % 2 for line in text.splitlines()):
+            return text
+        return minify_lines(text, "/*", "*/", "//")
+    return text
+
+
+def content_hash(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+
+def write_gzip(path, data):
+    # mtime 0 keeps the image reproducible
+    with open(path, "wb") as raw:
+        with gzip.GzipFile(filename="", mode="wb", fileobj=raw, compresslevel=9, mtime=0) as gz:
+            gz.write(data)
+
+
+def build_assets():
+    if os.path.isdir(OUT_DIR):
+        shutil.rmtree(OUT_DIR)
+    os.makedirs(OUT_DIR)
+
+    assets = {}
+    for name in sorted(os.listdir(SRC_DIR)):
+        src = os.path.join(SRC_DIR, name)
+        if not os.path.isfile(src):
+            continue
+        ext = os.path.splitext(name)[1]
+        if ext not in TYPES:
+            shutil.copyfile(src, os.path.join(OUT_DIR, name))
+            continue
+        with open(src, "rb") as f:
+            data = f.read()
+        if ext in (".html", ".css", ".js"):
+            data = minify(name, data.decode("utf-8")).encode("utf-8")
+        assets[name] = data
+
+    # the pages last, they carry the hashes of everything else
+    hashes = {}
+    for name in sorted(assets, key=lambda n: n.endswith(".html")):
+        data = assets[name]
+        if name.endswith(".html"):
+            text = data.decode("utf-8")
+            for other, h in hashes.items():
+                text = re.sub(r'((?:src|href)=")(?:\./|/)?' + re.escape(other) + '"',
+                              r"\g<1>" + other + "?v=" + h + '"', text)
+            data = text.encode("utf-8")
+        hashes[name] = content_hash(data)
+        write_gzip(os.path.join(OUT_DIR, name + ".gz"), data)
+
+    with open(os.path.join(OUT_DIR, "assets.txt"), "w") as manifest:
+        for name in sorted(assets):
+            ext = os.path.splitext(name)[1]
+            manifest.write('/%s "%s" %s\n' % (name, hashes[name], TYPES[ext]))
+
+    before = sum(os.path.getsize(os.path.join(SRC_DIR, n)) for n in assets)
+    after = sum(os.path.getsize(os.path.join(OUT_DIR, n + ".gz")) for n in assets)
+    print("Web assets: %d files, %d -> %d bytes" % (len(assets), before, after))
+
+
+build_assets()
+env.Replace(PROJECT_DATA_DIR=OUT_DIR)